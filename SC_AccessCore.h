@@ -0,0 +1,74 @@
+// SC_AccessCore.h
+// ESP32 dual-core access path: the network core hands decisions to an access task pinned to the
+// other core through SPSC queues, and publishes the tag store to it as an RCU snapshot, so the
+// access task decides from RAM without touching storage or waiting on the web server.
+// Plain C++ (no Arduino dependencies) so queueing, snapshots and decisions can be exercised on a
+// host with std::thread.
+#ifndef SC_ACCESS_CORE_H
+#define SC_ACCESS_CORE_H
+
+#include <stdint.h>
+#include "SC_TagId.h"
+#include "SC_Schedule.h"
+#include "SC_SpscRing.h"
+#include "SC_AccessProtocol.h"
+
+#ifndef ACCESS_SNAPSHOT_CAPACITY
+#define ACCESS_SNAPSHOT_CAPACITY 300 // Same as USER_TAG_CAPACITY
+#endif
+#define ACCESS_QUEUE_SIZE 16
+#define ACCESS_CORE_ID 0             // The Arduino loop (web server, OTA) runs on core 1
+#define ACCESS_CORE_TIMEOUT_MS 200   // How long an HTTP handler waits for the access task
+
+enum AccessSource : uint8_t {
+    ACCESS_SOURCE_HTTP = 0,
+    ACCESS_SOURCE_UDP = 1,
+    ACCESS_SOURCE_WIEGAND = 2,
+};
+
+// A decision request on its way to the access task, and its verdict on the way back
+struct AccessJob {
+    uint32_t token;
+    uint8_t source; // AccessSource
+    uint8_t op;     // AccessOp
+    uint8_t status; // AccessStatus, filled in by the access task
+    TagId tag;
+    uint32_t peerIp;   // UDP requests are answered from the network core
+    uint16_t peerPort;
+    uint16_t reader;
+    uint32_t seq;
+};
+
+typedef SpscRing<AccessJob, ACCESS_QUEUE_SIZE> AccessJobQueue;
+
+// Everything a decision reads: the active tag bank, its schedule ids and the schedule bitmaps
+struct TagSnapshot {
+    int count;
+    TagId tags[ACCESS_SNAPSHOT_CAPACITY];
+    uint8_t tagSchedule[ACCESS_SNAPSHOT_CAPACITY];
+    WeeklySchedule schedules[SCHEDULE_COUNT + 1]; // [0] opens every slot
+
+    int find(const TagId& tag) const {
+        for (int i = 0; i < count; i++) {
+            if (tags[i] == tag) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    // Same rule as UserManagementClass::tagAllowedNow(); unixTime 0 means no clock
+    uint8_t decide(const TagId& tag, uint32_t unixTime) const {
+        int index = find(tag);
+        if (index < 0) {
+            return ACCESS_DENIED;
+        }
+        uint8_t schedule = tagSchedule[index] <= SCHEDULE_COUNT ? tagSchedule[index] : 0;
+        if (schedule != 0 && (unixTime == 0 || !schedules[schedule].allows(scheduleSlot(unixTime)))) {
+            return ACCESS_DENIED;
+        }
+        return ACCESS_GRANTED;
+    }
+};
+
+#endif // SC_ACCESS_CORE_H
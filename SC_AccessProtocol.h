@@ -0,0 +1,231 @@
+// SC_AccessProtocol.h
+// Compact binary request/response protocol for card readers over UDP.
+#ifndef SC_ACCESS_PROTOCOL_H
+#define SC_ACCESS_PROTOCOL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#define ACCESS_UDP_PORT 4210
+#define ACCESS_KEY_LEN 16
+#define ACCESS_MAC_LEN 8
+#define ACCESS_TAG_FIELD_LEN 11 // Same as USER_TAG_LEN
+#define ACCESS_MAX_READERS 16 // Reader ids 0..15, one replay window each
+
+#define ACCESS_PROTO_MAGIC0 'S'
+#define ACCESS_PROTO_MAGIC1 'C'
+#define ACCESS_PROTO_VERSION 2 // 2: reader id and boot nonce in the frame
+
+// Request : magic(2) version(1) op(1) reader(2, LE) nonce(4, LE) seq(4, LE) tag(11, NUL padded) mac(8) = 33 bytes
+// Response: magic(2) version(1) op|0x80(1) reader(2, LE) nonce(4, LE) seq(4, LE) status(1) mac(8)    = 23 bytes
+// mac = SipHash-2-4 (128-bit shared key) over all preceding bytes, truncated to 64 bits.
+// nonce is the controller's challenge, drawn at every boot. A request carrying any other value
+// (recorded before a reboot, or from a reader that has not asked yet) is answered with
+// ACCESS_STALE_NONCE and the current nonce, so replay windows lost in a reboot cannot be
+// exploited. Readers learn the nonce from ACCESS_OP_CHALLENGE or from any response.
+#define ACCESS_REQUEST_LEN (14 + ACCESS_TAG_FIELD_LEN + ACCESS_MAC_LEN)
+#define ACCESS_RESPONSE_LEN (15 + ACCESS_MAC_LEN)
+
+enum AccessOp : uint8_t {
+    ACCESS_OP_USE_TAG = 0x01,   // Same as POST /api/users/use_tag
+    ACCESS_OP_CHECK_TAG = 0x02, // Same as POST /api/users/check_tag
+    ACCESS_OP_CHALLENGE = 0x03, // Asks for the boot nonce; tag and nonce are ignored
+};
+
+enum AccessStatus : uint8_t {
+    ACCESS_DENIED = 0x00,
+    ACCESS_GRANTED = 0x01,
+    ACCESS_BAD_REQUEST = 0x02,
+    ACCESS_REPLAYED = 0x03,
+    ACCESS_STALE_NONCE = 0x04, // Not from this boot; retry with the nonce in the response
+    ACCESS_NONCE = 0x05,       // Answer to ACCESS_OP_CHALLENGE
+};
+
+struct AccessRequest {
+    uint8_t op;
+    uint16_t reader;
+    uint32_t nonce;
+    uint32_t seq;
+    char tag[ACCESS_TAG_FIELD_LEN + 1]; // NUL terminated
+};
+
+struct AccessResponse {
+    uint8_t op; // Without the 0x80 response bit
+    uint16_t reader;
+    uint32_t nonce;
+    uint32_t seq;
+    uint8_t status;
+};
+
+class AccessProtocol {
+public:
+    // SipHash-2-4 of data under a 16-byte key.
+    static uint64_t sipHash(const uint8_t key[ACCESS_KEY_LEN], const uint8_t* data, size_t len) {
+        uint64_t k0 = readLE64(key);
+        uint64_t k1 = readLE64(key + 8);
+        uint64_t v0 = 0x736f6d6570736575ULL ^ k0;
+        uint64_t v1 = 0x646f72616e646f6dULL ^ k1;
+        uint64_t v2 = 0x6c7967656e657261ULL ^ k0;
+        uint64_t v3 = 0x7465646279746573ULL ^ k1;
+
+        size_t blocks = len / 8;
+        for (size_t i = 0; i < blocks; i++) {
+            uint64_t m = readLE64(data + i * 8);
+            v3 ^= m;
+            sipRound(v0, v1, v2, v3);
+            sipRound(v0, v1, v2, v3);
+            v0 ^= m;
+        }
+
+        uint64_t last = (uint64_t)(len & 0xFF) << 56;
+        const uint8_t* tail = data + blocks * 8;
+        for (size_t i = 0; i < (len & 7); i++) {
+            last |= (uint64_t)tail[i] << (8 * i);
+        }
+        v3 ^= last;
+        sipRound(v0, v1, v2, v3);
+        sipRound(v0, v1, v2, v3);
+        v0 ^= last;
+
+        v2 ^= 0xFF;
+        for (int i = 0; i < 4; i++) {
+            sipRound(v0, v1, v2, v3);
+        }
+        return v0 ^ v1 ^ v2 ^ v3;
+    }
+
+    // Parses and authenticates a request datagram. Returns false if the packet is malformed
+    // or the MAC does not match; nothing is trusted from a packet that fails here.
+    static bool decodeRequest(const uint8_t key[ACCESS_KEY_LEN], const uint8_t* buf, size_t len, AccessRequest& out) {
+        if (len != ACCESS_REQUEST_LEN || buf[0] != ACCESS_PROTO_MAGIC0 || buf[1] != ACCESS_PROTO_MAGIC1 ||
+            buf[2] != ACCESS_PROTO_VERSION) {
+            return false;
+        }
+        if (!macEquals(sipHash(key, buf, ACCESS_REQUEST_LEN - ACCESS_MAC_LEN), buf + ACCESS_REQUEST_LEN - ACCESS_MAC_LEN)) {
+            return false;
+        }
+        out.op = buf[3];
+        out.reader = readLE16(buf + 4);
+        out.nonce = readLE32(buf + 6);
+        out.seq = readLE32(buf + 10);
+        memcpy(out.tag, buf + 14, ACCESS_TAG_FIELD_LEN);
+        out.tag[ACCESS_TAG_FIELD_LEN] = '\0';
+        return true;
+    }
+
+    // Builds a request datagram (used by readers and host-side tools). Returns the frame length.
+    static size_t encodeRequest(const uint8_t key[ACCESS_KEY_LEN], uint8_t op, uint16_t reader, uint32_t nonce,
+                                uint32_t seq, const char* tag, uint8_t out[ACCESS_REQUEST_LEN]) {
+        out[0] = ACCESS_PROTO_MAGIC0;
+        out[1] = ACCESS_PROTO_MAGIC1;
+        out[2] = ACCESS_PROTO_VERSION;
+        out[3] = op;
+        writeLE16(out + 4, reader);
+        writeLE32(out + 6, nonce);
+        writeLE32(out + 10, seq);
+        memset(out + 14, 0, ACCESS_TAG_FIELD_LEN);
+        size_t tagLen = strlen(tag);
+        memcpy(out + 14, tag, tagLen > ACCESS_TAG_FIELD_LEN ? ACCESS_TAG_FIELD_LEN : tagLen);
+        writeLE64(out + ACCESS_REQUEST_LEN - ACCESS_MAC_LEN, sipHash(key, out, ACCESS_REQUEST_LEN - ACCESS_MAC_LEN));
+        return ACCESS_REQUEST_LEN;
+    }
+
+    static size_t encodeResponse(const uint8_t key[ACCESS_KEY_LEN], const AccessResponse& response,
+                                 uint8_t out[ACCESS_RESPONSE_LEN]) {
+        out[0] = ACCESS_PROTO_MAGIC0;
+        out[1] = ACCESS_PROTO_MAGIC1;
+        out[2] = ACCESS_PROTO_VERSION;
+        out[3] = response.op | 0x80;
+        writeLE16(out + 4, response.reader);
+        writeLE32(out + 6, response.nonce);
+        writeLE32(out + 10, response.seq);
+        out[14] = response.status;
+        writeLE64(out + ACCESS_RESPONSE_LEN - ACCESS_MAC_LEN, sipHash(key, out, ACCESS_RESPONSE_LEN - ACCESS_MAC_LEN));
+        return ACCESS_RESPONSE_LEN;
+    }
+
+    static bool decodeResponse(const uint8_t key[ACCESS_KEY_LEN], const uint8_t* buf, size_t len, AccessResponse& out) {
+        if (len != ACCESS_RESPONSE_LEN || buf[0] != ACCESS_PROTO_MAGIC0 || buf[1] != ACCESS_PROTO_MAGIC1 ||
+            buf[2] != ACCESS_PROTO_VERSION || !(buf[3] & 0x80)) {
+            return false;
+        }
+        if (!macEquals(sipHash(key, buf, ACCESS_RESPONSE_LEN - ACCESS_MAC_LEN), buf + ACCESS_RESPONSE_LEN - ACCESS_MAC_LEN)) {
+            return false;
+        }
+        out.op = buf[3] & 0x7F;
+        out.reader = readLE16(buf + 4);
+        out.nonce = readLE32(buf + 6);
+        out.seq = readLE32(buf + 10);
+        out.status = buf[14];
+        return true;
+    }
+
+private:
+    static inline uint64_t rotl(uint64_t x, int b) { return (x << b) | (x >> (64 - b)); }
+
+    static inline void sipRound(uint64_t& v0, uint64_t& v1, uint64_t& v2, uint64_t& v3) {
+        v0 += v1; v1 = rotl(v1, 13); v1 ^= v0; v0 = rotl(v0, 32);
+        v2 += v3; v3 = rotl(v3, 16); v3 ^= v2;
+        v0 += v3; v3 = rotl(v3, 21); v3 ^= v0;
+        v2 += v1; v1 = rotl(v1, 17); v1 ^= v2; v2 = rotl(v2, 32);
+    }
+
+    // Constant-time compare so the MAC check does not leak a prefix match.
+    static bool macEquals(uint64_t mac, const uint8_t* wire) {
+        uint8_t diff = 0;
+        for (int i = 0; i < ACCESS_MAC_LEN; i++) {
+            diff |= (uint8_t)(mac >> (8 * i)) ^ wire[i];
+        }
+        return diff == 0;
+    }
+
+    static inline uint16_t readLE16(const uint8_t* p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+    static inline uint32_t readLE32(const uint8_t* p) {
+        return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    }
+    static inline uint64_t readLE64(const uint8_t* p) {
+        return (uint64_t)readLE32(p) | ((uint64_t)readLE32(p + 4) << 32);
+    }
+    static inline void writeLE16(uint8_t* p, uint16_t v) {
+        p[0] = v; p[1] = v >> 8;
+    }
+    static inline void writeLE32(uint8_t* p, uint32_t v) {
+        p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24;
+    }
+    static inline void writeLE64(uint8_t* p, uint64_t v) {
+        writeLE32(p, (uint32_t)v);
+        writeLE32(p + 4, (uint32_t)(v >> 32));
+    }
+};
+
+// Per-reader replay window: a request is accepted only if its sequence number is newer than
+// the last one accepted from the same reader id since boot. The id is inside the MAC, so a
+// forged source address cannot reach another reader's window, and each id has its own slot,
+// so a flood from new addresses cannot evict one. Older boots are shut out by the nonce.
+// A reader that restarts on its own must not reuse sequence numbers: seed the counter randomly.
+class AccessReplayWindow {
+public:
+    AccessReplayWindow() {
+        memset(_lastSeq, 0, sizeof(_lastSeq));
+        memset(_seen, 0, sizeof(_seen));
+    }
+
+    bool accept(uint16_t reader, uint32_t seq) {
+        if (reader >= ACCESS_MAX_READERS) {
+            return false;
+        }
+        if (_seen[reader] && (int32_t)(seq - _lastSeq[reader]) <= 0) {
+            return false;
+        }
+        _seen[reader] = true;
+        _lastSeq[reader] = seq;
+        return true;
+    }
+
+private:
+    uint32_t _lastSeq[ACCESS_MAX_READERS];
+    bool _seen[ACCESS_MAX_READERS];
+};
+
+#endif // SC_ACCESS_PROTOCOL_H
@@ -0,0 +1,70 @@
+// SC_Bench.h
+// Per-operation cost accounting for the tag store: wall time, I2C traffic, write cycles and heap,
+// plus a 24C256 bus-time model so a run can be projected to tag counts the board cannot hold.
+#ifndef SC_BENCH_H
+#define SC_BENCH_H
+
+#include <Arduino.h>
+#include "SC_Metrics.h"
+
+#ifndef I2C_BUS_HZ
+#define I2C_BUS_HZ 100000 // Wire default clock
+#endif
+#define I2C_TWR_US 5000 // 24C256 worst-case internal write cycle
+
+#define BENCH_ITERATIONS 5
+#define BENCH_TAG "99999999999" // Added and removed again by the store/delete benchmark
+
+// 24C256 bus-time model: every transaction costs START, the device address byte and STOP;
+// every payload byte costs 9 clocks (8 data + ACK); every write cycle costs tWR.
+inline uint32_t benchModelBusUs(uint32_t transactions, uint32_t bytes, uint32_t writeCycles) {
+    uint64_t clocks = (uint64_t)transactions * 11 + (uint64_t)bytes * 9;
+    return (uint32_t)(clocks * 1000000ULL / I2C_BUS_HZ) + writeCycles * I2C_TWR_US;
+}
+
+struct BenchSample {
+    uint32_t us;
+    uint32_t transactions;
+    uint32_t bytesRead;
+    uint32_t bytesWritten;
+    uint32_t writeCycles;
+    int32_t heapDelta; // Net change over the operation; transient peaks are not visible
+
+    uint32_t modeledBusUs() const {
+        return benchModelBusUs(transactions, bytesRead + bytesWritten, writeCycles);
+    }
+};
+
+// Snapshot of the counters in scMetrics; sample() returns what happened since start().
+class BenchProbe {
+public:
+    void start() {
+        _heap = ESP.getFreeHeap();
+        _transactions = scMetrics.i2cTransactions[I2C_DEV_EEPROM];
+        _bytesRead = scMetrics.i2cBytesRead[I2C_DEV_EEPROM];
+        _bytesWritten = scMetrics.i2cBytesWritten[I2C_DEV_EEPROM];
+        _writeCycles = scMetrics.eepromWrites + scMetrics.eepromCommits;
+        _start = micros();
+    }
+
+    BenchSample sample() const {
+        BenchSample s;
+        s.us = micros() - _start;
+        s.transactions = scMetrics.i2cTransactions[I2C_DEV_EEPROM] - _transactions;
+        s.bytesRead = scMetrics.i2cBytesRead[I2C_DEV_EEPROM] - _bytesRead;
+        s.bytesWritten = scMetrics.i2cBytesWritten[I2C_DEV_EEPROM] - _bytesWritten;
+        s.writeCycles = scMetrics.eepromWrites + scMetrics.eepromCommits - _writeCycles;
+        s.heapDelta = (int32_t)_heap - (int32_t)ESP.getFreeHeap();
+        return s;
+    }
+
+private:
+    uint32_t _start;
+    uint32_t _heap;
+    uint32_t _transactions;
+    uint32_t _bytesRead;
+    uint32_t _bytesWritten;
+    uint32_t _writeCycles;
+};
+
+#endif // SC_BENCH_H
@@ -0,0 +1,33 @@
+// SC_Crc32.h
+// CRC-32 (IEEE 802.3, same as zlib) with a 16-entry nibble table: small enough for flash,
+// fast enough to run over the whole storage image while it streams.
+#ifndef SC_CRC32_H
+#define SC_CRC32_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define CRC32_INIT 0xFFFFFFFFu
+
+// Running form: start from CRC32_INIT, feed any number of blocks, finish with crc32Final().
+inline uint32_t crc32Update(uint32_t crc, const uint8_t* data, size_t len) {
+    static const uint32_t table[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C};
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        crc = (crc >> 4) ^ table[crc & 0x0F];
+        crc = (crc >> 4) ^ table[crc & 0x0F];
+    }
+    return crc;
+}
+
+inline uint32_t crc32Final(uint32_t crc) {
+    return crc ^ 0xFFFFFFFFu;
+}
+
+inline uint32_t crc32(const uint8_t* data, size_t len) {
+    return crc32Final(crc32Update(CRC32_INIT, data, len));
+}
+
+#endif // SC_CRC32_H
@@ -7,12 +7,32 @@
 #include <EEPROM.h>
 #include "RTClib.h" 
 #include <ArduinoJson.h> 
+#include "SC_AccessProtocol.h"
+#include "SC_OtaStream.h"
+#include "SC_Crc32.h"
+#include "SC_Metrics.h"
+#include "SC_Trace.h"
+#include "SC_Bench.h"
+#include "SC_TagId.h"
+#include "SC_SoftClock.h"
+#include "SC_Schedule.h"
+#include "SC_TimerWheel.h"
+#include "SC_RelayBank.h"
+#include "SC_Wiegand.h"
+#include "SC_TagBank.h"
+#include "SC_AccessCore.h"
+#include "SC_TagCodec.h"
+#include "SC_Rollup.h"
+#include "SC_Scrubber.h"
 
 #ifdef ESP32
+#include "SC_Rcu.h"
 #include <WiFi.h>
+#include <WiFiUdp.h>
 #include <WebServer.h>
 #elif ESP8266
 #include <ESP8266WiFi.h>
+#include <WiFiUdp.h>
 #include <ESP8266WebServer.h>
 #include <ESP8266HTTPUpdateServer.h> // NEW: Added for OTA
 #include <ESP8266mDNS.h>             // NEW: Added for mDNS
@@ -23,6 +43,13 @@
 #define USE_EXTERNAL_EEPROM // Define this to conditionally use external EEPROM
 #endif
 
+#define EX_EEPROM_PAGE_SIZE 64        // 24C256 write page
+#define EX_EEPROM_WIRE_CHUNK 64       // Bytes per Wire transaction (ESP Wire buffers hold 128)
+#define EX_EEPROM_WRITE_TIMEOUT_MS 10 // Upper bound for ACK polling after a page write
+#ifndef EX_EEPROM_DEVICE
+#define EX_EEPROM_DEVICE(address) EXTERNAL_EEPROM_ADDR // Device serving a storage address; parts over 64 KB add block-select bits
+#endif
+
 #define EEPROM_SDA_PIN 0
 #define EEPROM_SCL_PIN 2
 
@@ -31,19 +58,42 @@
 #define OTA_USERNAME "admin"          // NEW: OTA Credentials
 #define OTA_PASSWORD "admin"          // NEW: OTA Credentials
 
+// --- HTTP keep-alive for /api/* routes ---
+#define HTTP_KEEPALIVE_IDLE_MS 250        // Close a persistent connection after this long without a request
+#define HTTP_KEEPALIVE_MAX_REQUESTS 32    // Requests served on one connection before it is closed
+
+// --- Request lanes (RouteLane in SC_Routes.h) ---
+#define HTTP_READ_DEADLINE_MS 1500    // A new connection must deliver its first request within this
+#define HEAVY_ADMIT_BURST 2           // ROUTE_LANE_HEAVY requests admitted back to back...
+#define HEAVY_ADMIT_INTERVAL_MS 2000  // ...then one more per interval
+#define ACCESS_LANE_HOLD_MS 500       // Heavy and background work wait this long after an access request
+
 
 // --- Hardware Definitions ---
 #define RELAY_PIN 16
 #define EEPROM_SIZE 1024 // This will be used for both internal and external (if defined)
+#ifndef EX_EEPROM_SIZE
 #define EX_EEPROM_SIZE 32000 // This will be used for both internal and external (if defined)
+#endif
 
 #define SSID_MAX_LEN 15
 #define PASSWORD_MAX_LEN 15
 #define USER_TAG_LEN 11 
+#define TAG_SCAN_BATCH (EX_EEPROM_WIRE_CHUNK / USER_TAG_LEN) // Tag slots read per storage access during a scan
+#define ACCESS_PULSE_MS 5000 // How long the relay stays on after a granted tag
+#define AP_RELOAD_DELAY_MS 1000 // Lets the HTTP response leave before the AP is reconfigured
+#define TAG_EXPORT_DELTA_TYPE "application/x-sc-tag-delta" // get_tags in the SC_TagCodec.h encoding
+#define TAG_EXPORT_CHUNK 128 // Bytes per sendContent() while the delta export is streamed
+
+// Request bodies are parsed in ArduinoJson's zero-copy mode on one copy of the body (see
+// parseJsonBody()), so documents only hold the object slots; two spare slots keep a client that
+// sends an extra field from failing with NoMemory.
+#define BODY_DOC_SIZE(fields) JSON_OBJECT_SIZE((fields) + 2)
+#define JSON_NUMBER_TEXT_LEN 21 // A uint64_t in decimal, terminated
 //#define MAX_USER_TAGS 300
 
 // Core module settings
-#define RELAY_STATE_ADDR 0 // bool (1 byte)
+#define RELAY_STATE_ADDR 0 // uint8_t channel bitmask (1 byte); bit 0 is the original single relay
 #define OP_METHOD_ADDR 1 // uint8_t (1 byte)
 #define SSID_ADDR 2
 #define PASSWORD_ADDR 18
@@ -55,9 +105,45 @@
 #define USER_TAG_COUNT_ADDR 60 // int (4 bytes)
 #define USER_TAGS_START_ADDR 64 // Start address for user tags
 #define Statistics_START_ADDR  (USER_TAGS_START_ADDR + (MAX_USER_TAGS * USER_TAG_LEN))
+#define STATISTICS_LEN 512 // Holds the AccessRollup
+#define SCHEDULES_START_ADDR (Statistics_START_ADDR + STATISTICS_LEN) // SCHEDULE_COUNT weekly bitmaps
+#define TAG_SCHEDULES_START_ADDR (SCHEDULES_START_ADDR + SCHEDULE_COUNT * SCHEDULE_BITMAP_LEN) // 1 byte per tag slot
+#ifndef USER_TAG_CAPACITY
+#define USER_TAG_CAPACITY 300 // Upper bound for MAX_USER_TAGS; sizes the RAM schedule map
+#endif
+#define RELAY_SCHEDULES_START_ADDR (TAG_SCHEDULES_START_ADDR + USER_TAG_CAPACITY) // RELAY_SCHEDULE_COUNT RelaySchedule entries
+// Tag bank B mirrors bank A (USER_TAGS_START_ADDR, TAG_SCHEDULES_START_ADDR, USER_TAG_COUNT_ADDR)
+#define TAG_BANK_B_START_ADDR (RELAY_SCHEDULES_START_ADDR + RELAY_SCHEDULE_COUNT * sizeof(RelaySchedule))
+#define TAG_BANK_B_SCHEDULES_ADDR (TAG_BANK_B_START_ADDR + USER_TAG_CAPACITY * USER_TAG_LEN)
+#define TAG_BANK_B_COUNT_ADDR (TAG_BANK_B_SCHEDULES_ADDR + USER_TAG_CAPACITY) // int (4 bytes)
+// Two TagBankSuperblock slots, one per EEPROM page
+#define TAG_SUPERBLOCK_ADDR ((TAG_BANK_B_COUNT_ADDR + 4 + EX_EEPROM_PAGE_SIZE - 1) / EX_EEPROM_PAGE_SIZE * EX_EEPROM_PAGE_SIZE)
+#define TAG_SUPERBLOCK_END (TAG_SUPERBLOCK_ADDR + 2 * EX_EEPROM_PAGE_SIZE)
+#define RELAY_WHEEL_MAX_CATCHUP_S 120 // Larger clock gaps re-seed the relay timer wheel instead of ticking through
+#define CONFIG_BLOCK_LEN USER_TAGS_START_ADDR // Everything below the tag table
+// Scrubber (see SC_Scrubber.h): CRC table, then a mirror of the config block; not in backups
+#define SCRUB_TABLE_ADDR TAG_SUPERBLOCK_END
+#define SCRUB_MIRROR_ADDR (SCRUB_TABLE_ADDR + SCRUB_TABLE_LEN(SCRUB_MAX_BLOCKS))
+#define SCRUB_BUDGET_US 2000 // Scrub time per handleClient()
+// /api/restore stages the uploaded image here and copies it over the live data only once its
+// CRC has been checked; not in backups
+#define RESTORE_STAGING_ADDR ((SCRUB_MIRROR_ADDR + CONFIG_BLOCK_LEN + EX_EEPROM_PAGE_SIZE - 1) / EX_EEPROM_PAGE_SIZE * EX_EEPROM_PAGE_SIZE)
+
+// Backup image: header, storage bytes [0, length), CRC-32 trailer over those bytes (little-endian)
+#define STORAGE_IMAGE_MAGIC 0x4D494353 // "SCIM"
+#define STORAGE_IMAGE_VERSION 1
+#define STORAGE_IMAGE_BURST 128        // Bytes read or written per storage burst while streaming
+struct StorageImageHeader {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t reserved[3];
+    uint32_t length;
+};
 
 extern WebServer server; 
 
+#include "SC_Routes.h"
+
 // --- MainControlClass (Base Class) ---
 class MainControlClass {
 protected: // Protected members are accessible by derived classes
@@ -67,13 +153,180 @@ protected: // Protected members are accessible by derived classes
 #else
     EEPROMClass& _eeprom; // Reference to EEPROM
 #endif
-    int _relayPin; // Relay pin
+    int _relayPin; // Relay pin (channel 0 of _relays)
+    RelayBank _relays;
+
+    // Door pulse after a grant: channel 0 stays on until _accessPulseEnd and is never saved.
+    // Started by startAccessPulse() and ended by expireAccessPulse() from the access lane, so
+    // no reader or HTTP client waits out ACCESS_PULSE_MS. Shared like _keepAlive, so a relay
+    // schedule run by another class on the same pin does not save the pulse either.
+    static std::atomic<bool> _accessPulsing;
+    static unsigned long _accessPulseEnd;
+    // Pulse switches, counted here because the access task may make them; folded into
+    // scMetrics.relayActuations by the network loop, the only writer of scMetrics
+    static std::atomic<uint32_t> _accessActuations;
+    void startAccessPulse();
+    void expireAccessPulse();
 
 #ifdef ESP8266 // NEW: OTA Server and Hostname for ESP8266
     ESP8266HTTPUpdateServer _httpUpdater;
     const char* _hostname = "esp-control"; // Default mDNS hostname
+
+    // Resumable chunked OTA (see SC_OtaStream.h)
+    OtaStream _ota;
+    bool _otaChunkAccepted = false;
+#endif
+
+    // Persistent-connection bookkeeping, shared by every class registered on the one WebServer
+    struct KeepAliveState {
+        uint32_t peer;
+        uint16_t port;
+        uint16_t requests;
+        unsigned long lastRequest;
+    };
+    static KeepAliveState _keepAlive;
+
+    void beginApiRequest();
+    void expireIdleConnection();
+
+    // Request lanes, shared by every class on the one WebServer like _keepAlive
+    struct LaneState {
+        uint32_t peer;             // Connection the read deadline applies to
+        uint16_t port;
+        bool served;               // It has delivered a request
+        unsigned long acceptedAt;
+        uint8_t heavyTokens;       // Admission bucket for ROUTE_LANE_HEAVY
+        unsigned long heavyRefilledAt;
+        unsigned long accessHoldUntil;
+    };
+    static LaneState _lanes;
+    // First handler on the server: sees every request as it is parsed and claims none, so the
+    // read deadline knows the connection delivered one whichever handler serves it
+    class RequestTap : public SCRequestHandler {
+    public:
+        explicit RequestTap(MainControlClass* owner) : _owner(owner) {}
+        bool canHandle(HTTPMethod method, ROUTE_URI_ARG uri) override {
+            (void)method;
+            (void)uri;
+            _owner->noteRequestRead();
+            return false;
+        }
+
+    private:
+        MainControlClass* _owner;
+    };
+    RequestTap _requestTap{this};
+    void noteRequestRead();
+    static MainControlClass* _accessLaneOwner; // Instance whose pollAccessLane() serves the readers
+    bool admitHeavyRequest();
+    bool accessLaneHeld() const { return (long)(millis() - _lanes.accessHoldUntil) < 0; }
+    void enforceReadDeadline();
+    // Answers pending UDP and Wiegand readers; long handlers call it between bursts
+    void serviceAccessLane();
+    virtual void pollAccessLane() {}
+
+    DeserializationError parseJsonBody(JsonDocument& doc);
+    String _requestBody; // Copy of the body being parsed; doc points into it until the handler returns
+
+    // Streaming restore state; only allocated while an upload to /api/restore is running
+    struct RestoreState {
+        StorageImageHeader header;
+        uint32_t received;   // Bytes of header + payload + trailer seen so far
+        uint32_t crc;
+        uint8_t burst[STORAGE_IMAGE_BURST];
+        int burstAddr;       // Image offset of burst[0]
+        int burstFill;
+        uint8_t trailer[4];
+        bool failed;
+#ifndef USE_EXTERNAL_EEPROM
+        uint8_t staged[EEPROM_SIZE]; // The whole image fits in RAM on this backend
+#endif
+    };
+    RestoreState* _restore = nullptr;
+    void flushRestoreBurst();
+    void readStaged(int offset, uint8_t* buffer, int length);
+    void copyStaged(int offset, int address, int length);
+    bool applyRestore();
+
+    // Tag bank layout (see SC_TagBank.h)
+    int tagBankBase(uint8_t bank) const { return bank ? TAG_BANK_B_START_ADDR : USER_TAGS_START_ADDR; }
+    int tagBankSchedulesAddress(uint8_t bank) const { return bank ? TAG_BANK_B_SCHEDULES_ADDR : TAG_SCHEDULES_START_ADDR; }
+    int tagBankCountAddress(uint8_t bank) const { return bank ? TAG_BANK_B_COUNT_ADDR : USER_TAG_COUNT_ADDR; }
+
+    // Storage generations for conditional GETs: every write to the settings in the config block
+    // or to the tag banks (including bank A's count) bumps one, so an ETag built from them
+    // changes whenever the data behind it does
+    static uint32_t _configGeneration;
+    static uint32_t _tagGeneration;
+    static uint32_t _etagNonce; // Drawn at boot, so an ETag from before a restart never matches
+    void noteStorageWrite(int address, int length);
+    uint32_t tagGeneration() const { return _tagGeneration; }
+
+    // A GET response as rendered for one generation
+    struct CachedResponse {
+        uint32_t generation = 0; // 0 = nothing cached
+        String body;
+    };
+    bool notModified(uint32_t generation, char kind);
+    bool serveCached(CachedResponse& cache, uint32_t generation, char kind);
+    void sendCached(CachedResponse& cache, uint32_t generation, const String& body);
+    CachedResponse _ssidCache;
+    CachedResponse _networkInfoCache;
+    CachedResponse _opMethodCache;
+
+#ifdef USE_EXTERNAL_EEPROM
+    // Background integrity scrub of the config block and both tag banks; one per device, so
+    // every instance's storage writes reach it
+    static StorageScrubber _scrubber;
+    void beginScrubber();
 #endif
 
+    // Startup stages after beginAccess(); see beginAccessFirst()
+    enum BootStage : uint8_t {
+        BOOT_STAGE_AP,
+        BOOT_STAGE_OTA,
+        BOOT_STAGE_SERVER,
+        BOOT_STAGE_DONE,
+    };
+    BootStage _bootStage = BOOT_STAGE_DONE;
+    const char* _apSsid = nullptr;
+    const char* _apPassword = nullptr;
+    void beginAccess();
+    void advanceBoot();
+    void bootPhase(const char* name, uint32_t startUs);
+
+    // Stored AP credentials are applied from handleClient() once this is due
+    bool _apReloadPending = false;
+    unsigned long _apReloadAt = 0;
+    void scheduleAccessPointReload();
+    void applyAccessPoint();
+
+    // Every table-routed request goes through here
+    template <typename T>
+    void dispatchRoute(const char* path, void (T::*handler)(), RouteLane lane) {
+        SC_TRACE_SCOPE(path);
+        if (strncmp(path, "/api/", 5) == 0) {
+            beginApiRequest();
+        }
+        if (lane == ROUTE_LANE_HEAVY && !admitHeavyRequest()) {
+            return;
+        }
+        (static_cast<T*>(this)->*handler)();
+        if (lane == ROUTE_LANE_ACCESS) {
+            _lanes.accessHoldUntil = millis() + ACCESS_LANE_HOLD_MS;
+        }
+    }
+    template <typename T>
+    void dispatchUpload(void (T::*upload)()) {
+        serviceAccessLane(); // Uploads arrive in many chunks; readers go in between
+        (static_cast<T*>(this)->*upload)();
+    }
+    template <typename T> friend class RouteTableHandler;
+
+private:
+    static const Route<MainControlClass> kRoutes[]; // Sized by its initializer in SC_Library.cpp
+    RouteTableHandler<MainControlClass> _routeHandler;
+
 public:
     // Constructor for MainControlClass
 #ifdef USE_EXTERNAL_EEPROM
@@ -83,16 +336,38 @@ public:
 #endif
 
     void beginAPAndWebServer(const char* ap_ssid, const char* ap_password);
+    // Same, but returns once the relays are restored; handleClient() then brings the network up
+    void beginAccessFirst(const char* ap_ssid, const char* ap_password);
     void handleClient();
     void resetConfigurations();
+    // Re-applies settings from storage in place of a restart (relays now, AP shortly after)
+    virtual void reloadConfiguration();
+    // Called at the end of every handleClient(), once the server is up, for deferred work
+    virtual void serviceDeferred() {}
     void setRelayPhysicalState(bool state);
+    // Switches the channels in mask to the bits of values with one output write and one storage write
+    void setRelayChannels(uint8_t mask, uint8_t values);
+    // Optional, before beginAPAndWebServer(): drive up to RELAY_BANK_MAX_CHANNELS relays
+    void setRelayPins(const uint8_t* pins, uint8_t count);
     String readStringFromEEPROM(int address, int max_len);
-    void saveStringToEEPROM(int address, const String& data, int max_len);
-    void saveFixedStringToEEPROM(int address, const String& data, int max_len);
+    void saveStringToEEPROM(int address, const char* data, int max_len);
+    void saveFixedStringToEEPROM(int address, const char* data, int max_len);
     uint8_t readOperationMethod();
     void writeOperationMethod(uint8_t method);
     void saveRelayStateToEEPROM(bool state);
     bool getRelayStateFromEEPROM();
+    void saveRelayMaskToEEPROM(uint8_t mask);
+    uint8_t getRelayMaskFromEEPROM();
+
+    // Bulk storage access for either backend (page bursts on the external EEPROM)
+    void readStorage(int address, uint8_t* buffer, int length);
+    void writeStorage(int address, const uint8_t* buffer, int length);
+    int storageImageLength();
+#ifndef USE_EXTERNAL_EEPROM
+    // Writes to the RAM copy are not tracked one by one: pass the range written since the last
+    // commit, or leave the default when it is not known
+    void commitEEPROM(int address = 0, int length = EEPROM_SIZE);
+#endif
     
     // NEW: Function to set up OTA (made public for external call if needed, but called internally)
     void setupOTA(); 
@@ -112,6 +387,7 @@ public:
     void externalEEPROMWriteByte(unsigned int address, uint8_t data);
     void externalEEPROMReadBytes(unsigned int address, byte* buffer, int length);
     void externalEEPROMWriteBytes(unsigned int address, const byte* buffer, int length);
+    void externalEEPROMWaitReady();
     int externalEEPROMReadInt(unsigned int address);
     void externalEEPROMWriteInt(unsigned int address, int value);
     String externalEEPROMReadString(uint16_t address, uint16_t length);
@@ -144,6 +420,24 @@ private:
     void handleStatus();
     void handleReboot();
     void handleInfo();
+    void handleBackup();
+    void handleMetrics();
+    void handleLatency();
+#ifdef SC_TRACE_ENABLED
+    void handleTrace();
+#endif
+#ifdef USE_EXTERNAL_EEPROM
+    void handleScrub();
+#endif
+    void handleRestore();
+    void handleRestoreUpload();
+#ifdef ESP8266
+    void handleOtaBegin();
+    void handleOtaChunk();
+    void handleOtaChunkUpload();
+    void handleOtaStatus();
+    void handleOtaFinish();
+#endif
     
 };
 
@@ -152,6 +446,27 @@ class RTCManager : public MainControlClass {
 protected: 
     RTC_DS3231 _rtc;
     DateTime timeNow;
+    SoftClock _clock;
+
+private:
+    // Written by the SQW interrupt; read with interrupts off
+    static volatile uint32_t _sqwEdges;
+    static volatile uint32_t _sqwEdgeMs;
+    static void IRAM_ATTR onSqwEdge();
+    uint32_t _sqwSeen = 0;
+    bool _sqwEnabled = false;
+    uint32_t readRTCUnix();
+
+    // Relay schedules (see SC_Schedule.h): timer i fires entry i, timer
+    // RELAY_SCHEDULE_COUNT + i ends the pulse that entry i started
+    RelaySchedule _relaySchedules[RELAY_SCHEDULE_COUNT];
+    TimerWheel<2 * RELAY_SCHEDULE_COUNT> _relayWheel;
+    bool _relayWheelSeeded = false;
+    void seedRelayWheel(uint32_t now);
+    void fireRelayTimer(uint8_t id);
+
+    static const Route<RTCManager> kRoutes[]; // Sized by its initializer in SC_Library.cpp
+    RouteTableHandler<RTCManager> _routeHandler;
 // ... (rest of RTCManager remains the same) ...
 public:
 #ifdef USE_EXTERNAL_EEPROM
@@ -161,6 +476,8 @@ public:
 #endif
 
     bool beginRTC();
+    // Optional: wire the DS3231 SQW pin to sqwPin to phase-lock the clock to its 1 Hz output
+    bool beginSqw(uint8_t sqwPin);
     DateTime now();
     void adjustRTC(const DateTime& dateTime);
 
@@ -168,6 +485,13 @@ public:
     void handleGetTime();
     void handleSetTime();
     void setupRTCEndpoints();
+
+    // Relay schedules: load after beginRTC(), then call handleRelaySchedules() from loop()
+    void beginRelaySchedules();
+    void handleRelaySchedules();
+    void handleSetRelaySchedule();
+    void handleDeleteRelaySchedule();
+    void handleListRelaySchedules();
 };
 
 
@@ -176,6 +500,85 @@ class UserManagementClass : public MainControlClass {
 private:
     int _userTagCount; // Internal variable to keep track of the count
 
+    // Binary UDP access path (see SC_AccessProtocol.h)
+    WiFiUDP _accessUdp;
+    bool _accessUdpEnabled = false;
+    uint8_t _accessKey[ACCESS_KEY_LEN];
+    uint32_t _accessNonce = 0; // Boot challenge; requests must carry it
+    AccessReplayWindow _accessReplay;
+
+    // Wiegand reader on two GPIOs (see SC_Wiegand.h): the ISRs only fill _wiegandPulses
+    static WiegandRing _wiegandPulses;
+    static void IRAM_ATTR onWiegandD0();
+    static void IRAM_ATTR onWiegandD1();
+    WiegandDecoder _wiegandDecoder;
+    WiegandDebounce _wiegandDebounce;
+    bool _wiegandEnabled = false;
+    void useWiegandCard(uint32_t card);
+
+    // Active tag bank (see SC_TagBank.h), from the newest valid superblock
+    uint8_t _tagBank = 0;
+    uint32_t _tagBankSequence = 0;
+
+    // Streaming state of /api/users/replace_tags; only allocated while an upload is running
+    struct ReplaceState {
+        uint8_t bank;      // Inactive bank being filled
+        int count;
+        uint8_t burst[STORAGE_IMAGE_BURST];
+        int burstAddr;
+        int burstFill;
+        char line[TAG_ID_LEN + 8]; // "tag[,schedule]"
+        uint8_t lineLen;
+        uint8_t schedules[USER_TAG_CAPACITY];
+        bool failed;
+    };
+    ReplaceState* _replace = nullptr;
+    void replaceLine();
+    void flushReplaceBurst();
+
+#ifdef ESP32
+    // Dual-core access path (see SC_AccessCore.h); idle until beginAccessCore()
+    RcuCell<TagSnapshot> _tagSnapshot;
+    AccessJobQueue _accessJobs;     // Network core -> access task
+    AccessJobQueue _accessVerdicts; // Access task -> network core
+    std::atomic<uint32_t> _accessClock{0}; // Unix time, refreshed by serviceAccessCore(); 0 = no clock
+    TaskHandle_t _accessTask = nullptr;
+    uint32_t _accessToken = 0;
+    static void accessTaskEntry(void* self);
+    void runAccessCore();
+    void accessCoreDecide(AccessJob& job);
+    bool decideOnAccessCore(const TagId& tag, uint8_t op);
+    void deliverVerdict(const AccessJob& verdict);
+#endif
+    // Republishes the tag store to the access task after any change; no-op without one
+    void publishTagSnapshot();
+    void sendAccessResponse(uint8_t op, uint16_t reader, uint32_t seq, uint8_t status, IPAddress ip, uint16_t port);
+
+    // Access rollups (see SC_Rollup.h), written back to Statistics_START_ADDR in batches
+    AccessRollup _rollup;
+    uint8_t _rollupPending = 0;
+    unsigned long _rollupDirtySince = 0;
+    void loadRollup();
+    void recordAccess(bool granted);
+    void flushRollup();
+
+    // Master cards mirrored from ADD_CARD_ADDR / REMOVE_CARD_ADDR
+    TagId _addCard;
+    TagId _removeCard;
+
+    // get_tags (JSON) and get_count for the current tagGeneration()
+    CachedResponse _tagsCache;
+    CachedResponse _countCache;
+
+    static const Route<UserManagementClass> kRoutes[]; // Sized by its initializer in SC_Library.cpp
+    RouteTableHandler<UserManagementClass> _routeHandler;
+
+    // Access schedules (see SC_Schedule.h), mirrored in RAM by loadSchedules() so a swipe
+    // never reads storage for them. _schedules[0] opens every slot.
+    WeeklySchedule _schedules[SCHEDULE_COUNT + 1];
+    uint8_t _tagSchedule[USER_TAG_CAPACITY];
+    RTCManager* _clockSource = nullptr;
+
 public:
     // Constructor for UserManagementClass, calls base class constructor
 #ifdef USE_EXTERNAL_EEPROM
@@ -185,10 +588,37 @@ public:
 #endif
 // ... (rest of UserManagementClass remains the same) ...
     void setupUserEndpoints();
+    void reloadConfiguration() override;
+    void serviceDeferred() override;
+    void pollAccessLane() override;
+    void loadAdminCards();
+    bool isAddCard(const TagId& tag) const { return tag == _addCard; }
+    bool isRemoveCard(const TagId& tag) const { return tag == _removeCard; }
+    // Time source for access schedules; without one, only tags on schedule 0 are let in
+    void attachClock(RTCManager& rtc);
+
+    // Optional low-latency access path for card readers; call handleAccessUdp() from loop().
+    bool beginAccessUdp(const uint8_t key[ACCESS_KEY_LEN], uint16_t port = ACCESS_UDP_PORT);
+    void handleAccessUdp();
+
+#ifdef ESP32
+    // Optional: moves access decisions (UDP, use_tag, Wiegand) to a task pinned to core;
+    // call serviceAccessCore() from loop() to answer UDP readers and feed the clock.
+    bool beginAccessCore(uint8_t core = ACCESS_CORE_ID);
+    void serviceAccessCore();
+#endif
+
+    // Optional Wiegand 26/34 reader wired to D0/D1; call handleWiegand() from loop().
+    void beginWiegand(uint8_t d0Pin, uint8_t d1Pin);
+    void handleWiegand();
 public: 
     void saveUserTagCountToEEPROM(int count);
     int getUserTagCountFromEEPROM();
-    int findUserTagAddress(const String& tag);
+    int findUserTagAddress(const TagId& tag);
+    TagId readTag(int address);
+    void writeTag(int address, const TagId& tag);
+    int tagAddress(int index) const { return tagBankBase(_tagBank) + index * USER_TAG_LEN; }
+    void loadTagBank();
     int findEmptyUserTagSlot();
 
     // --- User Management Handlers ---
@@ -198,11 +628,30 @@ public:
     void handleGetUserTagCount();
     void handleUseingUserTag();
     void handleGettags();
-    String _trim(String& str);
+    void appendTagList(String& users);
+    void sendTagsDelta();
+    void handleSetSchedule();
+    void handleGetSchedule();
+    void handleAssignSchedule();
+    void handleGetStatistics();
+    void handleReplaceTags();
+    void handleReplaceTagsUpload();
+    void loadSchedules();
+    void setTagSchedule(int index, uint8_t schedule);
+    bool tagAllowedNow(int index);
+#ifdef SC_BENCH_ENABLED
+    void handleBench();
+#endif
     void handleDeleteAllUserTags();
-    bool storeTag(String tag);
-    bool DeleteTag(String tag);
-    bool checkTag(String tag);
+    bool storeTag(const TagId& tag);
+    bool DeleteTag(const TagId& tag);
+    bool checkTag(const TagId& tag);
+    bool decideAccess(const TagId& tag);
+    // Text forms for sketches: parsed with TagId::parse(), false if the tag is empty or too long
+    bool storeTag(const char* tag);
+    bool DeleteTag(const char* tag);
+    bool checkTag(const char* tag);
+    bool decideAccess(const char* tag);
     void addCard();
     void removeCard();
     String generatePassword() ;
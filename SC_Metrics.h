@@ -0,0 +1,136 @@
+// SC_Metrics.h
+// Lightweight instrumentation behind the /metrics endpoint (Prometheus text exposition format).
+// Hot-path updates are plain integer increments on a global; all formatting happens at scrape time.
+#ifndef SC_METRICS_H
+#define SC_METRICS_H
+
+#include <Arduino.h>
+
+#define METRICS_BUCKETS 10
+#define METRICS_FLUSH_LEN 1024 // /metrics sends a chunk whenever this much text is pending
+#define BOOT_MAX_PHASES 8
+
+// Upper bounds (microseconds) shared by every latency histogram
+static const uint32_t kMetricsBucketsUs[METRICS_BUCKETS] = {
+    100, 500, 1000, 5000, 10000, 50000, 100000, 500000, 1000000, 5000000};
+
+enum I2cDevice : uint8_t {
+    I2C_DEV_EEPROM = 0,
+    I2C_DEV_RTC = 1,
+    I2C_DEV_COUNT
+};
+
+struct LatencyHistogram {
+    uint32_t buckets[METRICS_BUCKETS + 1]; // Not cumulative; the last one is +Inf
+    uint32_t count;
+    uint64_t sumUs;
+    uint32_t maxUs;
+
+    inline void observe(uint32_t us) {
+        int i = 0;
+        while (i < METRICS_BUCKETS && us > kMetricsBucketsUs[i]) {
+            i++;
+        }
+        buckets[i]++;
+        count++;
+        sumUs += us;
+        if (us > maxUs) {
+            maxUs = us;
+        }
+    }
+
+    void reset() { memset(this, 0, sizeof(*this)); }
+
+    // Estimated quantile (0..1), interpolated linearly inside the bucket that holds it
+    uint32_t quantileUs(float q) const {
+        if (count == 0) {
+            return 0;
+        }
+        float rank = q * count;
+        uint32_t below = 0;
+        for (int i = 0; i <= METRICS_BUCKETS; i++) {
+            if (buckets[i] > 0 && below + buckets[i] >= rank) {
+                uint32_t lo = i ? kMetricsBucketsUs[i - 1] : 0;
+                uint32_t hi = i < METRICS_BUCKETS ? kMetricsBucketsUs[i] : maxUs;
+                if (hi > maxUs) {
+                    hi = maxUs;
+                }
+                if (hi <= lo) {
+                    return hi;
+                }
+                return lo + (uint32_t)((hi - lo) * ((rank - below) / buckets[i]));
+            }
+            below += buckets[i];
+        }
+        return maxUs;
+    }
+};
+
+struct BootPhase {
+    const char* name;
+    uint32_t startUs; // micros() since power-on
+    uint32_t durationUs;
+};
+
+struct SCMetrics {
+    uint32_t i2cTransactions[I2C_DEV_COUNT];
+    uint32_t i2cBytesRead[I2C_DEV_COUNT];
+    uint32_t i2cBytesWritten[I2C_DEV_COUNT];
+    uint32_t eepromWrites;  // Write cycles issued to the external EEPROM (byte or page)
+    uint32_t eepromCommits; // Flash commits of the emulated EEPROM
+    uint32_t relayActuations;
+    LatencyHistogram tagLookup;
+    LatencyHistogram loopTime; // Time between successive handleClient() calls
+    LatencyHistogram accessLane; // Handler time of ROUTE_LANE_ACCESS requests
+    uint32_t heavyRejected;      // ROUTE_LANE_HEAVY requests refused with 503
+    uint32_t readDeadlineDrops;  // Connections closed for not sending a request in time
+    uint32_t loopMaxUs;
+    uint32_t lastLoopUs;
+    uint32_t windowStartMs; // Start of the /api/latency window (boot or the last ?reset=1)
+    BootPhase bootPhases[BOOT_MAX_PHASES];
+    uint8_t bootPhaseCount;
+    uint32_t accessReadyUs;  // Relays restored and tag store loaded
+    uint32_t networkReadyUs; // Web server listening
+};
+
+extern SCMetrics scMetrics;
+
+inline void metricsI2c(I2cDevice device, uint32_t transactions, uint32_t bytesRead, uint32_t bytesWritten) {
+    scMetrics.i2cTransactions[device] += transactions;
+    scMetrics.i2cBytesRead[device] += bytesRead;
+    scMetrics.i2cBytesWritten[device] += bytesWritten;
+}
+
+inline void metricsBootPhase(const char* name, uint32_t startUs) {
+    if (scMetrics.bootPhaseCount < BOOT_MAX_PHASES) {
+        scMetrics.bootPhases[scMetrics.bootPhaseCount++] = {name, startUs, (uint32_t)micros() - startUs};
+    }
+}
+
+// Appends one histogram in exposition format; labels is either empty or "key=\"value\","
+inline void metricsAppendHistogram(String& out, const char* name, const char* labels, const LatencyHistogram& h) {
+    uint32_t cumulative = 0;
+    for (int i = 0; i <= METRICS_BUCKETS; i++) {
+        cumulative += h.buckets[i];
+        out += name;
+        out += "_bucket{";
+        out += labels;
+        out += "le=\"";
+        if (i < METRICS_BUCKETS) {
+            out += String(kMetricsBucketsUs[i] / 1e6, 4);
+        } else {
+            out += "+Inf";
+        }
+        out += "\"} ";
+        out += cumulative;
+        out += "\n";
+    }
+    String bare = labels;
+    if (bare.endsWith(",")) {
+        bare = bare.substring(0, bare.length() - 1);
+    }
+    out += String(name) + "_sum{" + bare + "} " + String(h.sumUs / 1e6, 6) + "\n";
+    out += String(name) + "_count{" + bare + "} " + String(h.count) + "\n";
+}
+
+#endif // SC_METRICS_H
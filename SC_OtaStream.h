@@ -0,0 +1,252 @@
+// SC_OtaStream.h
+// Streaming, resumable OTA image pipeline: incremental SHA-256 over the image as it arrives,
+// chunk offset tracking for resume, and a held-back final byte so a bad image is never committed.
+// Plain C++ (no Arduino dependencies) so the pipeline can be built and exercised on a host.
+#ifndef SC_OTA_STREAM_H
+#define SC_OTA_STREAM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#define OTA_SHA256_LEN 32
+
+class Sha256 {
+public:
+    Sha256() { reset(); }
+
+    void reset() {
+        static const uint32_t init[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                         0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+        memcpy(_h, init, sizeof(_h));
+        _length = 0;
+        _used = 0;
+    }
+
+    void update(const uint8_t* data, size_t len) {
+        _length += len;
+        while (len > 0) {
+            size_t take = 64 - _used;
+            if (take > len) take = len;
+            memcpy(_block + _used, data, take);
+            _used += take;
+            data += take;
+            len -= take;
+            if (_used == 64) {
+                compress(_block);
+                _used = 0;
+            }
+        }
+    }
+
+    // Finalises a copy, so the running hash can keep going after a peek.
+    void digest(uint8_t out[OTA_SHA256_LEN]) const {
+        Sha256 ctx = *this;
+        uint64_t bits = ctx._length * 8;
+        uint8_t pad = 0x80;
+        ctx.update(&pad, 1);
+        pad = 0;
+        while (ctx._used != 56) {
+            ctx.update(&pad, 1);
+        }
+        uint8_t lenBytes[8];
+        for (int i = 0; i < 8; i++) {
+            lenBytes[i] = (uint8_t)(bits >> (56 - 8 * i));
+        }
+        ctx.update(lenBytes, 8);
+        for (int i = 0; i < 8; i++) {
+            out[4 * i] = ctx._h[i] >> 24;
+            out[4 * i + 1] = ctx._h[i] >> 16;
+            out[4 * i + 2] = ctx._h[i] >> 8;
+            out[4 * i + 3] = ctx._h[i];
+        }
+    }
+
+private:
+    static inline uint32_t ror(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+    void compress(const uint8_t* block) {
+        static const uint32_t k[64] = {
+            0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+            0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+            0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+            0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+            0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+            0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+            0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+            0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+        uint32_t w[64];
+        for (int i = 0; i < 16; i++) {
+            w[i] = ((uint32_t)block[4 * i] << 24) | ((uint32_t)block[4 * i + 1] << 16) |
+                   ((uint32_t)block[4 * i + 2] << 8) | block[4 * i + 3];
+        }
+        for (int i = 16; i < 64; i++) {
+            uint32_t s0 = ror(w[i - 15], 7) ^ ror(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            uint32_t s1 = ror(w[i - 2], 17) ^ ror(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+        uint32_t a = _h[0], b = _h[1], c = _h[2], d = _h[3], e = _h[4], f = _h[5], g = _h[6], h = _h[7];
+        for (int i = 0; i < 64; i++) {
+            uint32_t t1 = h + (ror(e, 6) ^ ror(e, 11) ^ ror(e, 25)) + ((e & f) ^ (~e & g)) + k[i] + w[i];
+            uint32_t t2 = (ror(a, 2) ^ ror(a, 13) ^ ror(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            h = g; g = f; f = e; e = d + t1;
+            d = c; c = b; b = a; a = t1 + t2;
+        }
+        _h[0] += a; _h[1] += b; _h[2] += c; _h[3] += d;
+        _h[4] += e; _h[5] += f; _h[6] += g; _h[7] += h;
+    }
+
+    uint32_t _h[8];
+    uint64_t _length;
+    uint8_t _block[64];
+    size_t _used;
+};
+
+// Where verified image bytes go (the flash updater on the device, a buffer on a host).
+class OtaSink {
+public:
+    virtual size_t write(const uint8_t* data, size_t len) = 0;
+};
+
+enum OtaImageKind : uint8_t {
+    OTA_IMAGE_UNKNOWN = 0,
+    OTA_IMAGE_RAW = 1,  // 0xE9 ESP image header
+    OTA_IMAGE_GZIP = 2, // gzip member; inflated by the bootloader when it copies the image
+};
+
+class OtaStream {
+public:
+    bool begin(size_t size, const uint8_t expectedSha[OTA_SHA256_LEN]) {
+        if (size < 2) {
+            return false;
+        }
+        _size = size;
+        _offset = 0;
+        _headLen = 0;
+        _kind = OTA_IMAGE_UNKNOWN;
+        _active = true;
+        memcpy(_expected, expectedSha, OTA_SHA256_LEN);
+        _sha.reset();
+        return true;
+    }
+
+    // True if an upload of this exact image is already in progress and can be resumed.
+    bool resumable(size_t size, const uint8_t expectedSha[OTA_SHA256_LEN]) const {
+        return _active && _size == size && memcmp(_expected, expectedSha, OTA_SHA256_LEN) == 0;
+    }
+
+    // Accepts bytes at the current offset. Everything except the final image byte goes straight
+    // to the sink; that byte is held back until finish() has checked the hash. The first two
+    // bytes decide the image kind and may arrive in separate writes: they are held here until
+    // both are in, so nothing reaches the sink before the image is recognised.
+    // Returns the number of bytes consumed; less than len means the sink failed, the image is
+    // full or it is not an image at all.
+    size_t write(OtaSink& sink, const uint8_t* data, size_t len) {
+        if (!_active) {
+            return 0;
+        }
+        size_t start = offset();
+        if (len > _size - start) {
+            len = _size - start;
+        }
+        if (_kind == OTA_IMAGE_UNKNOWN) {
+            while (_headLen < 2 && len > 0) {
+                _head[_headLen++] = *data++;
+                len--;
+            }
+            if (_headLen < 2) {
+                return offset() - start;
+            }
+            _headLen = 0;
+            _kind = (_head[0] == 0x1F && _head[1] == 0x8B) ? OTA_IMAGE_GZIP
+                  : (_head[0] == 0xE9) ? OTA_IMAGE_RAW : OTA_IMAGE_UNKNOWN;
+            if (_kind == OTA_IMAGE_UNKNOWN) {
+                return 0;
+            }
+            if (commit(sink, _head, 2) < 2) {
+                return offset() - start;
+            }
+        }
+        commit(sink, data, len);
+        return offset() - start;
+    }
+
+    // Checks the hash of the complete image and, only if it matches, releases the final byte.
+    bool finish(OtaSink& sink) {
+        if (!_active || _offset != _size) {
+            return false;
+        }
+        uint8_t actual[OTA_SHA256_LEN];
+        _sha.digest(actual);
+        uint8_t diff = 0;
+        for (int i = 0; i < OTA_SHA256_LEN; i++) {
+            diff |= actual[i] ^ _expected[i];
+        }
+        if (diff != 0) {
+            return false;
+        }
+        _active = false;
+        return sink.write(&_last, 1) == 1;
+    }
+
+    void abort() { _active = false; }
+
+    bool active() const { return _active; }
+    size_t size() const { return _size; }
+    size_t offset() const { return _offset + _headLen; } // Acknowledged bytes; a client resumes from here
+    OtaImageKind kind() const { return _kind; }
+
+    static bool parseHex(const char* hex, uint8_t out[OTA_SHA256_LEN]) {
+        if (strlen(hex) != OTA_SHA256_LEN * 2) {
+            return false;
+        }
+        for (int i = 0; i < OTA_SHA256_LEN * 2; i++) {
+            char c = hex[i];
+            int v = (c >= '0' && c <= '9') ? c - '0'
+                  : (c >= 'a' && c <= 'f') ? c - 'a' + 10
+                  : (c >= 'A' && c <= 'F') ? c - 'A' + 10 : -1;
+            if (v < 0) {
+                return false;
+            }
+            out[i / 2] = (i & 1) ? (out[i / 2] | v) : (v << 4);
+        }
+        return true;
+    }
+
+private:
+    // Bytes at the current offset to the sink, holding back the final image byte
+    size_t commit(OtaSink& sink, const uint8_t* data, size_t len) {
+        if (len == 0) {
+            return 0;
+        }
+        size_t direct = len;
+        bool holdsLast = _offset + len == _size;
+        if (holdsLast) {
+            direct--;
+        }
+        size_t written = direct ? sink.write(data, direct) : 0;
+        _sha.update(data, written);
+        _offset += written;
+        if (written < direct) {
+            return written;
+        }
+        if (holdsLast) {
+            _last = data[direct];
+            _sha.update(&_last, 1);
+            _offset++;
+        }
+        return len;
+    }
+
+    Sha256 _sha;
+    uint8_t _expected[OTA_SHA256_LEN];
+    size_t _size = 0;
+    size_t _offset = 0;
+    uint8_t _last = 0;
+    uint8_t _head[2];        // First bytes, until the kind is known
+    uint8_t _headLen = 0;
+    OtaImageKind _kind = OTA_IMAGE_UNKNOWN;
+    bool _active = false;
+};
+
+#endif // SC_OTA_STREAM_H
@@ -0,0 +1,47 @@
+// SC_Rcu.h
+// Read-copy-update cell for one reader and one writer on different cores: the writer fills the
+// copy that is not published and swaps it in with one atomic store; the reader pins whichever
+// copy is current and never waits. The writer only waits (grace period) if the reader still
+// holds the copy it wants to reuse.
+// Plain C++ (no Arduino dependencies) so it can be exercised on a host with std::thread.
+#ifndef SC_RCU_H
+#define SC_RCU_H
+
+#include <stdint.h>
+#include <atomic>
+#include <thread>
+
+template <typename T>
+class RcuCell {
+public:
+    // Reader: the published copy stays intact until readUnlock()
+    const T& readLock() {
+        uint8_t index;
+        do {
+            index = _current.load(std::memory_order_acquire);
+            _reading.store(index, std::memory_order_seq_cst);
+        } while (_current.load(std::memory_order_seq_cst) != index); // Raced a publish; pin the new one
+        return _copies[index];
+    }
+
+    void readUnlock() { _reading.store(kIdle, std::memory_order_release); }
+
+    // Writer: the unpublished copy, once the reader has left it. Fill it completely, then publish().
+    T& writeBegin() {
+        uint8_t next = _current.load(std::memory_order_relaxed) ^ 1;
+        while (_reading.load(std::memory_order_seq_cst) == next) {
+            std::this_thread::yield();
+        }
+        return _copies[next];
+    }
+
+    void publish() { _current.store(_current.load(std::memory_order_relaxed) ^ 1, std::memory_order_release); }
+
+private:
+    static const uint8_t kIdle = 0xFF;
+    T _copies[2];
+    std::atomic<uint8_t> _current{0};
+    std::atomic<uint8_t> _reading{kIdle};
+};
+
+#endif // SC_RCU_H
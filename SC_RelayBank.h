@@ -0,0 +1,112 @@
+// SC_RelayBank.h
+// Relay outputs as one bank: channel states are a bitmask, and a change to any set of channels
+// is one write to the GPIO set register and one to the clear register for the pins they cover.
+// Those registers only touch the bits written as 1, so pins driven elsewhere are never
+// overwritten with a stale value the way a read-modify-write of the output register could.
+#ifndef SC_RELAY_BANK_H
+#define SC_RELAY_BANK_H
+
+#include <Arduino.h>
+
+#define RELAY_BANK_MAX_CHANNELS 8
+
+class RelayBank {
+public:
+    // Channel i drives pins[i]; channel 0 is the relay passed to the controller constructor
+    void setPins(const uint8_t* pins, uint8_t count) {
+        _count = count > RELAY_BANK_MAX_CHANNELS ? RELAY_BANK_MAX_CHANNELS : count;
+        for (uint8_t i = 0; i < _count; i++) {
+            _pins[i] = pins[i];
+        }
+    }
+
+    // Configures the pins and drives every channel to initial
+    void begin(uint8_t initial) {
+        for (uint8_t i = 0; i < _count; i++) {
+            pinMode(_pins[i], OUTPUT);
+        }
+        _state = ~initial & allChannels();
+        apply(allChannels(), initial);
+    }
+
+    uint8_t count() const { return _count; }
+    uint8_t allChannels() const { return (uint8_t)((1u << _count) - 1); }
+    uint8_t state() const { return _state; }
+
+    // Sets the channels in mask to the matching bits of values; returns the channels that changed.
+    // On ESP32 the access task pulses channels from the other core, hence the spinlock.
+    uint8_t apply(uint8_t mask, uint8_t values) {
+#ifdef ESP32
+        portENTER_CRITICAL(&_mux);
+        uint8_t changed = applyLocked(mask, values);
+        portEXIT_CRITICAL(&_mux);
+        return changed;
+#else
+        return applyLocked(mask, values);
+#endif
+    }
+
+private:
+    uint8_t applyLocked(uint8_t mask, uint8_t values) {
+        mask &= allChannels();
+        uint8_t next = (_state & ~mask) | (values & mask);
+        uint8_t changed = next ^ _state;
+        if (changed == 0) {
+            return 0;
+        }
+        uint32_t setBits = 0;
+        uint32_t clearBits = 0;
+        for (uint8_t i = 0; i < _count; i++) {
+            if (!(changed & (1 << i))) {
+                continue;
+            }
+            bool on = next & (1 << i);
+            if (_pins[i] < 32 && inOutputRegister(_pins[i])) {
+                if (on) {
+                    setBits |= 1UL << _pins[i];
+                } else {
+                    clearBits |= 1UL << _pins[i];
+                }
+            } else {
+                digitalWrite(_pins[i], on ? HIGH : LOW);
+            }
+        }
+#ifdef ESP8266
+        if (setBits) {
+            GPOS = setBits;
+        }
+        if (clearBits) {
+            GPOC = clearBits;
+        }
+#elif defined(ESP32)
+        if (setBits) {
+            REG_WRITE(GPIO_OUT_W1TS_REG, setBits);
+        }
+        if (clearBits) {
+            REG_WRITE(GPIO_OUT_W1TC_REG, clearBits);
+        }
+#endif
+        _state = next;
+        return changed;
+    }
+
+    static bool inOutputRegister(uint8_t pin) {
+#ifdef ESP8266
+        return pin < 16; // GPIO16 sits in the RTC block and has its own register
+#elif defined(ESP32)
+        return pin < 32; // GPIO32+ are in GPIO_OUT1_REG
+#else
+        (void)pin;
+        return false;
+#endif
+    }
+
+    uint8_t _pins[RELAY_BANK_MAX_CHANNELS];
+    uint8_t _count = 0;
+    uint8_t _state = 0;
+#ifdef ESP32
+    portMUX_TYPE _mux = portMUX_INITIALIZER_UNLOCKED;
+#endif
+};
+
+#endif // SC_RELAY_BANK_H
@@ -0,0 +1,76 @@
+// SC_Rollup.h
+// Access rollups: grant and denial counters per hour of day, per weekday and per day over a
+// rolling window, bumped in RAM on every decision and written back in batches. Serving them is
+// a read of fixed-size arrays, never a scan.
+#ifndef SC_ROLLUP_H
+#define SC_ROLLUP_H
+
+#include <stdint.h>
+#include <string.h>
+#include "SC_Crc32.h"
+
+#define ROLLUP_MAGIC 0x4C4F5253 // "SROL"
+#define ROLLUP_VERSION 1
+#define ROLLUP_DAYS 14            // Rolling window of per-day counters
+#define ROLLUP_FLUSH_EVENTS 32    // Decisions buffered in RAM before a write-back
+#define ROLLUP_FLUSH_MS 600000UL  // ...or this long after the first unsaved one
+
+struct AccessCount {
+    uint32_t grants;
+    uint32_t denials;
+
+    void add(bool granted) { granted ? grants++ : denials++; }
+};
+
+struct AccessRollup {
+    uint32_t magic;
+    uint32_t version;
+    AccessCount total;
+    AccessCount hourOfDay[24];           // UTC hours, as the RTC keeps them
+    AccessCount weekday[7];              // 0 = Sunday
+    uint32_t dayNumber[ROLLUP_DAYS];     // Days since 1970-01-01 each slot currently counts
+    AccessCount day[ROLLUP_DAYS];        // Slot = dayNumber % ROLLUP_DAYS
+    uint32_t crc;
+
+    void clear() {
+        memset(this, 0, sizeof(*this));
+        magic = ROLLUP_MAGIC;
+        version = ROLLUP_VERSION;
+    }
+
+    // Storage copy is usable; callers clear() otherwise
+    bool valid() const {
+        return magic == ROLLUP_MAGIC && version == ROLLUP_VERSION && crc == computeCrc();
+    }
+
+    uint32_t computeCrc() const {
+        return crc32((const uint8_t*)this, sizeof(*this) - sizeof(crc));
+    }
+
+    void seal() { crc = computeCrc(); }
+
+    // unixTime 0 (no clock) only counts towards the total
+    void record(uint32_t unixTime, bool granted) {
+        total.add(granted);
+        if (unixTime == 0) {
+            return;
+        }
+        uint32_t dayNo = unixTime / 86400;
+        hourOfDay[(unixTime % 86400) / 3600].add(granted);
+        weekday[(dayNo + 4) % 7].add(granted); // 1970-01-01 was a Thursday
+        uint8_t slot = dayNo % ROLLUP_DAYS;
+        if (dayNumber[slot] != dayNo) {
+            dayNumber[slot] = dayNo;
+            day[slot] = AccessCount{0, 0};
+        }
+        day[slot].add(granted);
+    }
+
+    // Counts for a given day, zero when it is outside the window
+    AccessCount forDay(uint32_t dayNo) const {
+        uint8_t slot = dayNo % ROLLUP_DAYS;
+        return dayNumber[slot] == dayNo ? day[slot] : AccessCount{0, 0};
+    }
+};
+
+#endif // SC_ROLLUP_H
@@ -0,0 +1,227 @@
+// SC_Routes.h
+// Compile-time route tables with perfect-hash dispatch.
+// Each class keeps its routes in a constexpr table sized by its initializer; a seed is searched at
+// compile time so that every (path, method) pair lands in its own bucket, and one RequestHandler
+// per table serves them all.
+#ifndef SC_ROUTES_H
+#define SC_ROUTES_H
+
+#include <Arduino.h>
+#include "SC_Metrics.h"
+
+#define ROUTE_MAX_SEED_TRIES 4096
+
+// How a route is scheduled against the rest of the traffic (see MainControlClass::dispatchRoute)
+enum RouteLane : uint8_t {
+    ROUTE_LANE_NORMAL = 0,
+    ROUTE_LANE_ACCESS, // Door-side decisions: hold off heavy and background work for a moment
+    ROUTE_LANE_HEAVY,  // Long admin exports: admission-limited, serve the access lane while running
+};
+
+template <typename T>
+struct Route {
+    const char* path;
+    HTTPMethod method; // HTTP_ANY matches every method
+    void (T::*handler)();
+    void (T::*upload)() = nullptr;     // Optional: called for each chunk of a multipart upload to this route
+    RouteLane lane = ROUTE_LANE_NORMAL;
+};
+
+template <typename T, size_t N>
+constexpr size_t routeTableSize(const Route<T> (&)[N]) {
+    return N;
+}
+
+constexpr uint32_t routeHash(const char* path, HTTPMethod method, uint32_t seed) {
+    uint32_t h = 2166136261u ^ seed; // FNV-1a, seeded
+    for (; *path; ++path) {
+        h = (h ^ (uint8_t)*path) * 16777619u;
+    }
+    h = (h ^ (uint8_t)method) * 16777619u;
+    return h ^ (h >> 15);
+}
+
+constexpr size_t routeBucketCount(size_t routes) {
+    size_t buckets = 8;
+    while (buckets < routes * 4) {
+        buckets <<= 1;
+    }
+    return buckets;
+}
+
+template <size_t N>
+struct RouteIndex {
+    static constexpr size_t kBuckets = routeBucketCount(N);
+    uint32_t seed;
+    bool found;
+    uint8_t slot[kBuckets]; // route index + 1, 0 = empty
+
+    constexpr int lookup(const char* path, HTTPMethod method) const {
+        uint8_t s = slot[routeHash(path, method, seed) & (kBuckets - 1)];
+        return s ? s - 1 : -1;
+    }
+};
+
+template <typename T, size_t N>
+constexpr RouteIndex<N> buildRouteIndex(const Route<T> (&routes)[N]) {
+    static_assert(N < 255, "route index stores slots as uint8_t");
+    RouteIndex<N> index{};
+    for (uint32_t seed = 1; seed < ROUTE_MAX_SEED_TRIES; seed++) {
+        for (size_t b = 0; b < RouteIndex<N>::kBuckets; b++) {
+            index.slot[b] = 0;
+        }
+        bool collision = false;
+        for (size_t i = 0; i < N && !collision; i++) {
+            size_t b = routeHash(routes[i].path, routes[i].method, seed) & (RouteIndex<N>::kBuckets - 1);
+            if (index.slot[b]) {
+                collision = true;
+            } else {
+                index.slot[b] = (uint8_t)(i + 1);
+            }
+        }
+        if (!collision) {
+            index.seed = seed;
+            index.found = true;
+            return index;
+        }
+    }
+    index.found = false;
+    return index;
+}
+
+inline bool routePathEquals(const char* a, const char* b) {
+    return strcmp(a, b) == 0;
+}
+
+#ifdef ESP32
+typedef RequestHandler SCRequestHandler;
+#define ROUTE_URI_ARG String
+#define ROUTE_SERVER_ARG WebServer
+#else
+typedef WebServer::RequestHandlerType SCRequestHandler;
+#define ROUTE_URI_ARG const String&
+#define ROUTE_SERVER_ARG WebServer
+#endif
+
+// Per-route request statistics. Attached tables are linked into one list so /metrics can walk them.
+class RouteMetricsTable {
+public:
+    virtual size_t routeCount() const = 0;
+    virtual const char* routePath(size_t i) const = 0;
+    virtual HTTPMethod routeMethod(size_t i) const = 0;
+    virtual const LatencyHistogram& routeLatency(size_t i) const = 0;
+    virtual void resetLatency() = 0;
+
+    RouteMetricsTable* nextTable() const { return _nextTable; }
+    static RouteMetricsTable* firstTable() { return _firstTable; }
+
+protected:
+    void linkTable() {
+        _nextTable = _firstTable;
+        _firstTable = this;
+    }
+
+private:
+    RouteMetricsTable* _nextTable = nullptr;
+    static RouteMetricsTable* _firstTable;
+};
+
+// Single request handler for a whole route table. Holds no heap state: the table and its
+// index are constexpr statics, and the handler itself is a member of the owning object.
+template <typename T>
+class RouteTableHandler : public SCRequestHandler, public RouteMetricsTable {
+public:
+    explicit RouteTableHandler(T* owner) : _owner(owner) {}
+
+    // Serves routes through index, installs the table on the server and makes its statistics
+    // (kept in latency, one histogram per route) visible to /metrics
+    template <size_t N>
+    void attach(WebServer& server, const Route<T> (&routes)[N], const RouteIndex<N>& index, LatencyHistogram (&latency)[N]) {
+        _routes = routes;
+        _count = N;
+        _seed = index.seed;
+        _slot = index.slot;
+        _bucketMask = RouteIndex<N>::kBuckets - 1;
+        _latency = latency;
+        server.addHandler(this);
+        linkTable();
+    }
+
+    size_t routeCount() const override { return _count; }
+    const char* routePath(size_t i) const override { return _routes[i].path; }
+    HTTPMethod routeMethod(size_t i) const override { return _routes[i].method; }
+    const LatencyHistogram& routeLatency(size_t i) const override { return _latency[i]; }
+    void resetLatency() override {
+        for (size_t i = 0; i < _count; i++) {
+            _latency[i].reset();
+        }
+    }
+
+    bool canHandle(HTTPMethod method, ROUTE_URI_ARG uri) override {
+        _matched = match(uri.c_str(), method);
+        return _matched >= 0;
+    }
+
+    bool handle(ROUTE_SERVER_ARG& server, HTTPMethod method, ROUTE_URI_ARG uri) override {
+        (void)server;
+        int route = _matched >= 0 ? _matched : match(uri.c_str(), method);
+        _matched = -1;
+        if (route < 0) {
+            return false;
+        }
+        uint32_t start = micros();
+        _owner->dispatchRoute(_routes[route].path, _routes[route].handler, _routes[route].lane);
+        uint32_t elapsed = micros() - start;
+        _latency[route].observe(elapsed);
+        if (_routes[route].lane == ROUTE_LANE_ACCESS) {
+            scMetrics.accessLane.observe(elapsed);
+        }
+        return true;
+    }
+
+    bool canUpload(ROUTE_URI_ARG uri) override {
+        int route = match(uri.c_str(), HTTP_POST);
+        return route >= 0 && _routes[route].upload != nullptr;
+    }
+
+    void upload(ROUTE_SERVER_ARG& server, ROUTE_URI_ARG uri, HTTPUpload& chunk) override {
+        (void)server;
+        (void)chunk; // The owner reads it back through _server.upload()
+        int route = match(uri.c_str(), HTTP_POST);
+        if (route >= 0 && _routes[route].upload != nullptr) {
+            _owner->dispatchUpload(_routes[route].upload);
+        }
+    }
+
+private:
+    int lookup(const char* path, HTTPMethod method) const {
+        if (_count == 0) {
+            return -1;
+        }
+        uint8_t s = _slot[routeHash(path, method, _seed) & _bucketMask];
+        return s ? s - 1 : -1;
+    }
+
+    int match(const char* path, HTTPMethod method) const {
+        int route = lookup(path, method);
+        if (route >= 0 && _routes[route].method == method && routePathEquals(_routes[route].path, path)) {
+            return route;
+        }
+        route = lookup(path, HTTP_ANY);
+        if (route >= 0 && _routes[route].method == HTTP_ANY && routePathEquals(_routes[route].path, path)) {
+            return route;
+        }
+        return -1;
+    }
+
+    T* _owner;
+    const Route<T>* _routes = nullptr;
+    size_t _count = 0; // 0 until attach()
+    uint32_t _seed = 0;
+    const uint8_t* _slot = nullptr;
+    size_t _bucketMask = 0;
+    LatencyHistogram* _latency = nullptr;
+    int _matched = -1;
+};
+
+#endif // SC_ROUTES_H
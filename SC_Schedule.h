@@ -0,0 +1,122 @@
+// SC_Schedule.h
+// Weekly access schedules as precomputed bitmaps: one bit per 15-minute slot of the week, so
+// deciding whether a tag may open the door now is a shift and a mask on a RAM byte.
+// Plain C++ (no Arduino dependencies) so schedules can be compiled and checked on a host.
+#ifndef SC_SCHEDULE_H
+#define SC_SCHEDULE_H
+
+#include <stdint.h>
+#include <string.h>
+
+#define SCHEDULE_COUNT 8 // Assignable schedule ids are 1..SCHEDULE_COUNT; 0 means any time
+#define SCHEDULE_SLOT_MINUTES 15
+#define SCHEDULE_SLOTS_PER_DAY (24 * 60 / SCHEDULE_SLOT_MINUTES)
+#define SCHEDULE_SLOTS_PER_WEEK (7 * SCHEDULE_SLOTS_PER_DAY)
+#define SCHEDULE_BITMAP_LEN (SCHEDULE_SLOTS_PER_WEEK / 8) // 84 bytes
+#define SCHEDULE_MAX_WINDOWS 8 // Windows accepted per schedule in one set_schedule request
+
+struct WeeklySchedule {
+    uint8_t bits[SCHEDULE_BITMAP_LEN]; // Slot 0 is Sunday 00:00-00:15
+
+    void clear() { memset(bits, 0x00, sizeof(bits)); }
+    void fill() { memset(bits, 0xFF, sizeof(bits)); }
+
+    // Opens [startMinute, endMinute) on every day in dayMask (bit 0 = Sunday, as RTClib counts).
+    // Start rounds down and end rounds up to a slot; an end at or before the start runs past
+    // midnight into the next day, and equal times open the whole day.
+    void addWindow(uint8_t dayMask, uint16_t startMinute, uint16_t endMinute) {
+        uint16_t first = startMinute / SCHEDULE_SLOT_MINUTES;
+        uint16_t last = (endMinute + SCHEDULE_SLOT_MINUTES - 1) / SCHEDULE_SLOT_MINUTES;
+        uint16_t length = (last + SCHEDULE_SLOTS_PER_DAY - first) % SCHEDULE_SLOTS_PER_DAY;
+        if (length == 0) {
+            length = SCHEDULE_SLOTS_PER_DAY;
+        }
+        for (uint8_t day = 0; day < 7; day++) {
+            if (!(dayMask & (1 << day))) {
+                continue;
+            }
+            for (uint16_t i = 0; i < length; i++) {
+                uint16_t slot = (day * SCHEDULE_SLOTS_PER_DAY + first + i) % SCHEDULE_SLOTS_PER_WEEK;
+                bits[slot >> 3] |= 1 << (slot & 7);
+            }
+        }
+    }
+
+    bool allows(uint16_t slot) const {
+        return (bits[slot >> 3] >> (slot & 7)) & 1;
+    }
+};
+
+// Slot of the week for a Unix time; 1970-01-01 was a Thursday (day 4)
+inline uint16_t scheduleSlot(uint32_t unixTime) {
+    return ((unixTime / 86400 + 4) % 7) * SCHEDULE_SLOTS_PER_DAY + (unixTime % 86400) / (SCHEDULE_SLOT_MINUTES * 60);
+}
+
+// "HH:MM" (24 h) to minutes after midnight; "24:00" is accepted as the end of the day
+inline bool scheduleParseTime(const char* text, uint16_t& minutes) {
+    if (strlen(text) != 5 || text[2] != ':') {
+        return false;
+    }
+    for (int i = 0; i < 5; i++) {
+        if (i != 2 && (text[i] < '0' || text[i] > '9')) {
+            return false;
+        }
+    }
+    int hours = (text[0] - '0') * 10 + (text[1] - '0');
+    int mins = (text[3] - '0') * 10 + (text[4] - '0');
+    if (mins > 59 || hours > 24 || (hours == 24 && mins != 0)) {
+        return false;
+    }
+    minutes = hours * 60 + mins;
+    return true;
+}
+
+// Relay schedules: weekly recurring events that switch or pulse the relay
+#define RELAY_SCHEDULE_COUNT 16
+
+enum RelayAction : uint8_t {
+    RELAY_ACTION_OFF = 0,
+    RELAY_ACTION_ON = 1,
+    RELAY_ACTION_PULSE = 2, // On for pulseSeconds, then off
+};
+
+struct RelaySchedule {
+    uint8_t days;          // bit 0 = Sunday; 0 (or erased storage) = unused entry
+    uint8_t action;        // RelayAction
+    uint8_t channels;      // Relay bank channel mask
+    uint8_t reserved;
+    uint16_t minute;       // Minute of the day
+    uint16_t pulseSeconds;
+
+    bool valid() const {
+        return days != 0 && !(days & 0x80) && channels != 0 && minute < 24 * 60 && action <= RELAY_ACTION_PULSE;
+    }
+
+    // First occurrence strictly after the given Unix time
+    uint32_t nextAfter(uint32_t after) const {
+        uint32_t midnight = after - after % 86400;
+        for (int d = 0; d <= 7; d++) {
+            uint32_t day = midnight + d * 86400UL;
+            uint32_t at = day + minute * 60UL;
+            if (at > after && (days & (1 << ((day / 86400 + 4) % 7)))) {
+                return at;
+            }
+        }
+        return 0; // Unreachable for a valid entry
+    }
+
+    // Last occurrence at or before the given Unix time, 0 if none in the past week
+    uint32_t lastAtOrBefore(uint32_t time) const {
+        uint32_t midnight = time - time % 86400;
+        for (int d = 0; d <= 7; d++) {
+            uint32_t day = midnight - d * 86400UL;
+            uint32_t at = day + minute * 60UL;
+            if (at <= time && (days & (1 << ((day / 86400 + 4) % 7)))) {
+                return at;
+            }
+        }
+        return 0;
+    }
+};
+
+#endif // SC_SCHEDULE_H
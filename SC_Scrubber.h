@@ -0,0 +1,268 @@
+// SC_Scrubber.h
+// Background integrity scrubber: storage regions are split into 64-byte blocks, each with a
+// CRC-32 kept in a table in storage (and in RAM). Every loop a few slices of the current block
+// are read within a time budget; a finished block is compared with its CRC. Blocks written
+// since their last check are re-sealed instead, so only writes the firmware did not make
+// (bit rot, a write torn by a power cut) show up as errors. The first region can be mirrored;
+// a corrupt block there is repaired from the mirror when the mirror still matches its CRC.
+#ifndef SC_SCRUBBER_H
+#define SC_SCRUBBER_H
+
+#include <stdint.h>
+#include <string.h>
+#include "SC_Crc32.h"
+
+#define SCRUB_BLOCK_LEN 64
+#define SCRUB_SLICE_LEN 16     // Bytes read per step; ~1.5 ms on a 100 kHz bus
+#define SCRUB_MAX_BLOCKS 128
+#define SCRUB_MAX_REGIONS 4
+#define SCRUB_TABLE_MAGIC 0x42524353 // "SCRB"
+#define SCRUB_TABLE_HEADER_LEN 8     // magic, block count, reserved
+#define SCRUB_TABLE_LEN(blocks) (SCRUB_TABLE_HEADER_LEN + 4 * (blocks))
+
+class ScrubStorage {
+public:
+    virtual void read(int address, uint8_t* buffer, int length) = 0;
+    virtual void write(int address, const uint8_t* buffer, int length) = 0;
+};
+
+struct ScrubRegion {
+    int start;
+    int length;
+};
+
+struct ScrubStats {
+    uint32_t passes;      // Complete sweeps over every block
+    uint32_t checked;     // Blocks compared with their CRC
+    uint32_t resealed;    // Blocks re-sealed after a firmware write
+    uint32_t errors;      // Blocks found corrupt (once per block until it is rewritten or repaired)
+    uint32_t repaired;    // ...of which restored from the mirror
+    uint16_t badBlocks;   // Blocks currently known to be corrupt
+    int lastErrorAddress; // Start of the last corrupt block, -1 if none
+};
+
+class StorageScrubber {
+public:
+    // tableAddress holds SCRUB_TABLE_LEN(blocks()) bytes; mirrorAddress (or -1) holds a copy of
+    // regions[0]. A table with another layout is rebuilt by re-sealing every block.
+    void begin(ScrubStorage& storage, const ScrubRegion* regions, uint8_t regionCount, int tableAddress, int mirrorAddress) {
+        _storage = &storage;
+        _regionCount = regionCount > SCRUB_MAX_REGIONS ? SCRUB_MAX_REGIONS : regionCount;
+        _blocks = 0;
+        for (uint8_t r = 0; r < _regionCount; r++) {
+            _regions[r] = regions[r];
+            _firstBlock[r] = _blocks;
+            _blocks += (regions[r].length + SCRUB_BLOCK_LEN - 1) / SCRUB_BLOCK_LEN;
+        }
+        if (_blocks > SCRUB_MAX_BLOCKS) {
+            _blocks = SCRUB_MAX_BLOCKS;
+        }
+        _tableAddress = tableAddress;
+        _mirrorAddress = mirrorAddress;
+        memset(&_stats, 0, sizeof(_stats));
+        _stats.lastErrorAddress = -1;
+
+        uint32_t header[2];
+        _storage->read(_tableAddress, (uint8_t*)header, sizeof(header));
+        bool tableValid = header[0] == SCRUB_TABLE_MAGIC && header[1] == _blocks;
+        if (tableValid) {
+            _storage->read(_tableAddress + SCRUB_TABLE_HEADER_LEN, (uint8_t*)_crc, 4 * _blocks);
+        } else {
+            header[0] = SCRUB_TABLE_MAGIC;
+            header[1] = _blocks;
+            selfWrite(_tableAddress, (const uint8_t*)header, sizeof(header));
+        }
+        memset(_dirty, 0, sizeof(_dirty));
+        memset(_bad, 0, sizeof(_bad));
+        if (!tableValid) {
+            noteAll();
+        }
+        _sweep = 0;
+        startBlock(0);
+        _running = true;
+    }
+
+    bool running() const { return _running; }
+    uint16_t blocks() const { return _blocks; }
+    uint16_t position() const { return _block; }
+    const ScrubStats& stats() const { return _stats; }
+
+    // Every firmware write to storage goes through here so its blocks are re-sealed, not flagged
+    void noteWrite(int address, int length) {
+        if (!_running || _selfWriting) {
+            return;
+        }
+        for (uint8_t r = 0; r < _regionCount; r++) {
+            int from = address > _regions[r].start ? address : _regions[r].start;
+            int to = address + length < _regions[r].start + _regions[r].length ? address + length : _regions[r].start + _regions[r].length;
+            if (from >= to) {
+                continue;
+            }
+            uint16_t first = _firstBlock[r] + (from - _regions[r].start) / SCRUB_BLOCK_LEN;
+            uint16_t last = _firstBlock[r] + (to - 1 - _regions[r].start) / SCRUB_BLOCK_LEN;
+            for (uint16_t b = first; b <= last && b < _blocks; b++) {
+                _dirty[b >> 3] |= 1 << (b & 7);
+            }
+        }
+    }
+
+    // Re-seals every block written since its last visit; call before a restart so those
+    // writes are not reported (and the config block rolled back) on the next boot
+    void seal() {
+        if (!_running) {
+            return;
+        }
+        while (_resealing || anyDirty()) {
+            _storage->read(_address + _offset, _buffer + _offset, _length - _offset);
+            _offset = _length;
+            finishBlock();
+        }
+    }
+
+    // Reads slices until budgetUs has passed (at least one); nowUs() is a microsecond clock
+    template <typename Clock>
+    void step(uint32_t budgetUs, Clock nowUs) {
+        if (!_running || _blocks == 0) {
+            return;
+        }
+        uint32_t start = nowUs();
+        do {
+            int n = _length - _offset < SCRUB_SLICE_LEN ? _length - _offset : SCRUB_SLICE_LEN;
+            _storage->read(_address + _offset, _buffer + _offset, n);
+            _offset += n;
+            if (_offset == _length) {
+                finishBlock();
+            }
+        } while (nowUs() - start < budgetUs);
+    }
+
+private:
+    bool isDirty(uint16_t b) const { return _dirty[b >> 3] & (1 << (b & 7)); }
+    void clearDirty(uint16_t b) { _dirty[b >> 3] &= ~(1 << (b & 7)); }
+    void noteAll() {
+        for (uint16_t b = 0; b < _blocks; b++) {
+            _dirty[b >> 3] |= 1 << (b & 7);
+        }
+    }
+    bool anyDirty() const {
+        for (uint16_t i = 0; i < sizeof(_dirty); i++) {
+            if (_dirty[i]) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void startBlock(uint16_t b) {
+        _block = b;
+        uint8_t r = 0;
+        while (r + 1 < _regionCount && b >= _firstBlock[r + 1]) {
+            r++;
+        }
+        _region = r;
+        int offset = (b - _firstBlock[r]) * SCRUB_BLOCK_LEN;
+        _address = _regions[r].start + offset;
+        _length = _regions[r].length - offset < SCRUB_BLOCK_LEN ? _regions[r].length - offset : SCRUB_BLOCK_LEN;
+        _offset = 0;
+        _resealing = isDirty(b);
+        clearDirty(b);
+    }
+
+    void finishBlock() {
+        if (isDirty(_block)) {
+            startBlock(_block); // Written again while being read: read it once more
+            return;
+        }
+        uint32_t crc = crc32(_buffer, _length);
+        if (_resealing) {
+            setBad(false);
+            _crc[_block] = crc;
+            selfWrite(_tableAddress + SCRUB_TABLE_HEADER_LEN + 4 * _block, (const uint8_t*)&crc, 4);
+            if (_region == 0 && _mirrorAddress >= 0) {
+                selfWrite(_mirrorAddress + (_address - _regions[0].start), _buffer, _length);
+            }
+            _stats.resealed++;
+        } else {
+            _stats.checked++;
+            if (crc != _crc[_block]) {
+                if (!isBad(_block)) {
+                    _stats.errors++;
+                    _stats.lastErrorAddress = _address;
+                }
+                setBad(!repair());
+            } else {
+                setBad(false);
+            }
+        }
+        nextBlock();
+    }
+
+    bool repair() {
+        if (_region != 0 || _mirrorAddress < 0) {
+            return false;
+        }
+        _storage->read(_mirrorAddress + (_address - _regions[0].start), _buffer, _length);
+        if (crc32(_buffer, _length) != _crc[_block]) {
+            return false;
+        }
+        selfWrite(_address, _buffer, _length);
+        _stats.repaired++;
+        return true;
+    }
+
+    bool isBad(uint16_t b) const { return _bad[b >> 3] & (1 << (b & 7)); }
+    void setBad(bool bad) {
+        if (bad == isBad(_block)) {
+            return;
+        }
+        _bad[_block >> 3] ^= 1 << (_block & 7);
+        bad ? _stats.badBlocks++ : _stats.badBlocks--;
+    }
+
+    // Blocks awaiting a re-seal go first, then the sweep continues in order
+    void nextBlock() {
+        for (uint16_t b = 0; b < _blocks; b++) {
+            if (isDirty(b)) {
+                startBlock(b);
+                return;
+            }
+        }
+        uint16_t next = _sweep + 1;
+        if (next >= _blocks) {
+            next = 0;
+            _stats.passes++;
+        }
+        _sweep = next;
+        startBlock(next);
+    }
+
+    void selfWrite(int address, const uint8_t* buffer, int length) {
+        _selfWriting = true;
+        _storage->write(address, buffer, length);
+        _selfWriting = false;
+    }
+
+    ScrubStorage* _storage = nullptr;
+    ScrubRegion _regions[SCRUB_MAX_REGIONS];
+    uint16_t _firstBlock[SCRUB_MAX_REGIONS];
+    uint8_t _regionCount = 0;
+    uint16_t _blocks = 0;
+    int _tableAddress = 0;
+    int _mirrorAddress = -1;
+    uint32_t _crc[SCRUB_MAX_BLOCKS];
+    uint8_t _dirty[SCRUB_MAX_BLOCKS / 8]; // Written since last visited: re-seal, don't check
+    uint8_t _bad[SCRUB_MAX_BLOCKS / 8];   // Failed their last check
+    uint8_t _buffer[SCRUB_BLOCK_LEN];
+    uint16_t _block = 0;  // Block being read
+    uint16_t _sweep = 0;  // Position of the in-order sweep
+    uint8_t _region = 0;
+    int _address = 0;
+    int _length = 0;
+    int _offset = 0;
+    bool _resealing = false;
+    bool _selfWriting = false;
+    bool _running = false;
+    ScrubStats _stats;
+};
+
+#endif // SC_SCRUBBER_H
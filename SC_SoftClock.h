@@ -0,0 +1,129 @@
+// SC_SoftClock.h
+// Software wall clock disciplined by the DS3231: the RTC is read once, then time advances from
+// millis() with a drift correction, and is re-anchored either periodically over I2C or on every
+// edge of the DS3231's 1 Hz SQW output. Reading the time is a RAM computation.
+#ifndef SC_SOFT_CLOCK_H
+#define SC_SOFT_CLOCK_H
+
+#include <stdint.h>
+
+#define SOFTCLOCK_RESYNC_MS 3600000UL            // I2C re-read of the RTC when no SQW edges arrive
+#define SOFTCLOCK_DRIFT_BASELINE_MS 21600000UL   // Without SQW, drift is estimated over at least 6 h
+#define SOFTCLOCK_MAX_BASELINE_MS 1728000000UL   // Restart the baseline well before millis() wraps
+#define SOFTCLOCK_MAX_DRIFT_PPM 500              // Anything larger is a bad estimate, not a crystal
+
+class SoftClock {
+public:
+    // Anchors to an RTC reading taken at an unknown point inside its second. The first reading
+    // is taken as the middle of that second; later ones only pull the running estimate back
+    // inside [rtc, rtc + 1 s), which is the most the reading can say.
+    void sync(uint32_t rtcUnix, uint32_t localMs) {
+        uint64_t rtcMs = (uint64_t)rtcUnix * 1000;
+        if (!_synced) {
+            anchor(rtcMs + 500, localMs);
+            _phaseErrorMs = 500;
+            startBaseline(rtcMs, localMs);
+            _synced = true;
+            return;
+        }
+        updateDrift(rtcMs, localMs, 1000);
+        uint64_t estimate = unixMsAt(localMs);
+        if (estimate < rtcMs) {
+            estimate = rtcMs;
+        } else if (estimate >= rtcMs + 1000) {
+            estimate = rtcMs + 999;
+        }
+        anchor(estimate, localMs);
+    }
+
+    // Anchors to an RTC reading taken just after a 1 Hz edge: the second began at edgeMs.
+    void syncAtEdge(uint32_t rtcUnix, uint32_t edgeMs) {
+        uint64_t rtcMs = (uint64_t)rtcUnix * 1000;
+        if (!_synced || !_edgeLocked) {
+            startBaseline(rtcMs, edgeMs);
+        } else {
+            updateDrift(rtcMs, edgeMs, 1);
+        }
+        anchor(rtcMs, edgeMs);
+        _phaseErrorMs = 1;
+        _synced = true;
+        _edgeLocked = true;
+    }
+
+    // A later 1 Hz edge: time at edgeMs is a whole second, so the estimate is rounded onto it.
+    void edge(uint32_t edgeMs) {
+        if (!_edgeLocked) {
+            return;
+        }
+        uint64_t second = (unixMsAt(edgeMs) + 500) / 1000 * 1000;
+        updateDrift(second, edgeMs, 1);
+        anchor(second, edgeMs);
+    }
+
+    void invalidate() {
+        _synced = false;
+        _edgeLocked = false;
+        _baselineUsed = false;
+        _driftPpm = 0;
+    }
+
+    bool synced() const { return _synced; }
+    bool edgeLocked() const { return _edgeLocked; }
+    bool due(uint32_t localMs) const { return !_synced || localMs - _anchorLocalMs >= SOFTCLOCK_RESYNC_MS; }
+
+    uint64_t unixMsAt(uint32_t localMs) const {
+        uint32_t elapsed = localMs - _anchorLocalMs;
+        return _anchorUnixMs + elapsed + (int64_t)elapsed * _driftPpm / 1000000;
+    }
+
+    uint32_t unixAt(uint32_t localMs) const { return (uint32_t)(unixMsAt(localMs) / 1000); }
+
+    int32_t driftPpm() const { return _driftPpm; }
+
+    // Worst case: phase uncertainty of the anchor plus what an uncorrected crystal could gain since
+    uint32_t errorBoundMs(uint32_t localMs) const {
+        uint32_t elapsed = localMs - _anchorLocalMs;
+        uint32_t residualPpm = _edgeLocked ? 5 : (_baselineUsed ? 50 : SOFTCLOCK_MAX_DRIFT_PPM);
+        return _phaseErrorMs + (uint32_t)((uint64_t)elapsed * residualPpm / 1000000);
+    }
+
+private:
+    void anchor(uint64_t unixMs, uint32_t localMs) {
+        _anchorUnixMs = unixMs;
+        _anchorLocalMs = localMs;
+    }
+
+    void startBaseline(uint64_t unixMs, uint32_t localMs) {
+        _baseUnixMs = unixMs;
+        _baseLocalMs = localMs;
+    }
+
+    // Drift over the baseline: reference time elapsed versus local time elapsed.
+    // resolutionMs is how precisely the reference is known (1 s for a bare read, 1 ms for an edge).
+    void updateDrift(uint64_t unixMs, uint32_t localMs, uint32_t resolutionMs) {
+        uint32_t elapsed = localMs - _baseLocalMs;
+        uint32_t minBaseline = resolutionMs > 1 ? SOFTCLOCK_DRIFT_BASELINE_MS : 600000UL;
+        if (elapsed >= minBaseline) {
+            int64_t ppm = ((int64_t)(unixMs - _baseUnixMs) - (int64_t)elapsed) * 1000000 / elapsed;
+            if (ppm > -SOFTCLOCK_MAX_DRIFT_PPM && ppm < SOFTCLOCK_MAX_DRIFT_PPM) {
+                _driftPpm = (int32_t)ppm;
+                _baselineUsed = true;
+            }
+        }
+        if (elapsed >= SOFTCLOCK_MAX_BASELINE_MS) {
+            startBaseline(unixMs, localMs);
+        }
+    }
+
+    uint64_t _anchorUnixMs = 0;
+    uint32_t _anchorLocalMs = 0;
+    uint64_t _baseUnixMs = 0;
+    uint32_t _baseLocalMs = 0;
+    int32_t _driftPpm = 0;
+    uint32_t _phaseErrorMs = 500;
+    bool _synced = false;
+    bool _edgeLocked = false;
+    bool _baselineUsed = false;
+};
+
+#endif // SC_SOFT_CLOCK_H
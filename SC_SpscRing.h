@@ -0,0 +1,53 @@
+// SC_SpscRing.h
+// Lock-free single-producer/single-consumer ring: the producer only writes _head, the consumer
+// only writes _tail, so an ISR (or another core) can feed the main loop without locks.
+// Plain C++ (no Arduino dependencies) so it can be exercised on a host.
+#ifndef SC_SPSC_RING_H
+#define SC_SPSC_RING_H
+
+#include <stdint.h>
+#include <atomic>
+
+template <typename T, uint32_t N>
+class SpscRing {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "ring size must be a power of two");
+
+public:
+    // Producer side; false (item dropped) when full. Always inlined so an ISR calling it stays
+    // entirely in IRAM.
+    __attribute__((always_inline)) bool push(const T& item) {
+        uint32_t head = _head.load(std::memory_order_relaxed);
+        if (head - _tail.load(std::memory_order_acquire) == N) {
+            _dropped++;
+            return false;
+        }
+        _items[head & (N - 1)] = item;
+        _head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side; false when empty
+    bool pop(T& item) {
+        uint32_t tail = _tail.load(std::memory_order_relaxed);
+        if (tail == _head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = _items[tail & (N - 1)];
+        _tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    uint32_t size() const {
+        return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire);
+    }
+
+    uint32_t dropped() const { return _dropped; }
+
+private:
+    T _items[N];
+    std::atomic<uint32_t> _head{0};
+    std::atomic<uint32_t> _tail{0};
+    uint32_t _dropped = 0; // Producer-owned
+};
+
+#endif // SC_SPSC_RING_H
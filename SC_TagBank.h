@@ -0,0 +1,53 @@
+// SC_TagBank.h
+// A/B tag banks: a full tag list is written into the inactive bank while lookups keep using the
+// active one, then a superblock write makes the new bank active. The superblock has two slots in
+// separate EEPROM pages, written alternately; the newest slot with a valid CRC wins, so a write
+// torn by a power cut leaves the previous bank in charge.
+#ifndef SC_TAG_BANK_H
+#define SC_TAG_BANK_H
+
+#include <stdint.h>
+#include "SC_Crc32.h"
+
+#define TAG_BANK_MAGIC 0x4B424354 // "TCBK"
+
+struct TagBankSuperblock {
+    uint32_t magic;
+    uint32_t sequence; // Incremented by every flip
+    uint8_t bank;      // Active bank, 0 (A) or 1 (B)
+    uint8_t reserved[3];
+    uint32_t crc;      // CRC-32 of the fields above
+
+    bool valid() const {
+        return magic == TAG_BANK_MAGIC && bank < 2 && crc == computeCrc();
+    }
+
+    uint32_t computeCrc() const {
+        return crc32((const uint8_t*)this, sizeof(*this) - sizeof(crc));
+    }
+
+    static TagBankSuperblock make(uint32_t sequence, uint8_t bank) {
+        TagBankSuperblock sb = {TAG_BANK_MAGIC, sequence, bank, {0, 0, 0}, 0};
+        sb.crc = sb.computeCrc();
+        return sb;
+    }
+
+    // Slot the superblock with this sequence number lives in
+    static uint8_t slotFor(uint32_t sequence) { return sequence & 1; }
+};
+
+// Newest valid superblock of the two slots; bank A, sequence 0 when neither is valid
+// (storage that predates the banks, or an erased part)
+inline TagBankSuperblock tagBankSelect(const TagBankSuperblock slots[2]) {
+    bool a = slots[0].valid();
+    bool b = slots[1].valid();
+    if (a && b) {
+        return (int32_t)(slots[1].sequence - slots[0].sequence) > 0 ? slots[1] : slots[0];
+    }
+    if (a || b) {
+        return a ? slots[0] : slots[1];
+    }
+    return TagBankSuperblock::make(0, 0);
+}
+
+#endif // SC_TAG_BANK_H
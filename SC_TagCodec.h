@@ -0,0 +1,172 @@
+// SC_TagCodec.h
+// Compact tag list export: card numbers sorted ascending, stored as the first value and then
+// the gaps between neighbours, each as an LEB128 varint, with a CRC-32 trailer. Dense card
+// ranges cost one or two bytes per tag instead of the ~12 of the JSON list.
+//
+// Layout: "SCTD" | version (1) | varint count | varint value[0] | varint value[i] - value[i-1]
+//         ... | CRC-32 of everything before it (little-endian)
+#ifndef SC_TAG_CODEC_H
+#define SC_TAG_CODEC_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "SC_Crc32.h"
+#include "SC_TagId.h"
+
+#define TAG_CODEC_MAGIC "SCTD"
+#define TAG_CODEC_VERSION 1
+#define TAG_CODEC_MAX_VARINT 10
+// Worst case for n tags: 11-digit numbers need at most 6 varint bytes each
+#define TAG_CODEC_MAX_LEN(n) (4 + 1 + 5 + (size_t)(n) * 6 + 4)
+
+// Tag digits as a number; false if the tag is not all digits
+inline bool tagCodecValue(const TagId& tag, uint64_t& value) {
+    value = 0;
+    for (int i = 0; i < TAG_ID_LEN; i++) {
+        if (tag.digits[i] < '0' || tag.digits[i] > '9') {
+            return false;
+        }
+        value = value * 10 + (tag.digits[i] - '0');
+    }
+    return true;
+}
+
+inline size_t tagCodecPutVarint(uint8_t* out, uint64_t value) {
+    size_t n = 0;
+    while (value >= 0x80) {
+        out[n++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    out[n++] = (uint8_t)value;
+    return n;
+}
+
+inline bool tagCodecGetVarint(const uint8_t* in, size_t len, size_t& pos, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 7 * TAG_CODEC_MAX_VARINT && pos < len; shift += 7) {
+        uint8_t b = in[pos++];
+        value |= (uint64_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+inline size_t tagCodecVarintLen(uint64_t value) {
+    size_t n = 1;
+    for (; value >= 0x80; value >>= 7) {
+        n++;
+    }
+    return n;
+}
+
+inline void tagCodecSiftDown(uint64_t* values, size_t root, size_t n) {
+    uint64_t v = values[root];
+    for (size_t child = 2 * root + 1; child < n; child = 2 * root + 1) {
+        if (child + 1 < n && values[child + 1] > values[child]) {
+            child++;
+        }
+        if (values[child] <= v) {
+            break;
+        }
+        values[root] = values[child];
+        root = child;
+    }
+    values[root] = v;
+}
+
+// Sorts values in place: heapsort, O(n log n) with no extra memory at any table size
+inline void tagCodecSort(uint64_t* values, size_t n) {
+    for (size_t i = n / 2; i-- > 0;) {
+        tagCodecSiftDown(values, i, n);
+    }
+    for (size_t end = n; end-- > 1;) {
+        uint64_t top = values[0];
+        values[0] = values[end];
+        values[end] = top;
+        tagCodecSiftDown(values, 0, end);
+    }
+}
+
+// Exact encoded length of sorted values, so a response can announce it before streaming
+inline size_t tagCodecEncodedLen(const uint64_t* sorted, size_t n) {
+    size_t len = 4 + 1 + tagCodecVarintLen(n) + 4;
+    uint64_t previous = 0;
+    for (size_t i = 0; i < n; i++) {
+        len += tagCodecVarintLen(sorted[i] - previous);
+        previous = sorted[i];
+    }
+    return len;
+}
+
+// Encodes in pieces, for output sent as it is produced: header(), value() for each sorted value,
+// then trailer(). Each returns the bytes written to out, at most TAG_CODEC_MAX_VARINT + 5.
+struct TagCodecEncoder {
+    uint32_t crc = CRC32_INIT;
+    uint64_t previous = 0;
+
+    size_t header(size_t n, uint8_t* out) {
+        memcpy(out, TAG_CODEC_MAGIC, 4);
+        out[4] = TAG_CODEC_VERSION;
+        return add(out, 5 + tagCodecPutVarint(out + 5, n));
+    }
+    size_t value(uint64_t v, uint8_t* out) {
+        size_t len = tagCodecPutVarint(out, v - previous);
+        previous = v;
+        return add(out, len);
+    }
+    size_t trailer(uint8_t* out) {
+        uint32_t sum = crc32Final(crc);
+        memcpy(out, &sum, sizeof(sum));
+        return sizeof(sum);
+    }
+
+private:
+    size_t add(const uint8_t* out, size_t len) {
+        crc = crc32Update(crc, out, len);
+        return len;
+    }
+};
+
+// Encodes sorted values into out (at least TAG_CODEC_MAX_LEN(n) bytes); returns the length
+inline size_t tagCodecEncode(const uint64_t* sorted, size_t n, uint8_t* out) {
+    TagCodecEncoder encoder;
+    size_t len = encoder.header(n, out);
+    for (size_t i = 0; i < n; i++) {
+        len += encoder.value(sorted[i], out + len);
+    }
+    return len + encoder.trailer(out + len);
+}
+
+// Decodes up to capacity values; false on a bad header, CRC, truncation or too many values
+inline bool tagCodecDecode(const uint8_t* in, size_t len, uint64_t* values, size_t capacity, size_t& n) {
+    if (len < 4 + 1 + 1 + 4 || memcmp(in, TAG_CODEC_MAGIC, 4) != 0 || in[4] != TAG_CODEC_VERSION) {
+        return false;
+    }
+    uint32_t crc;
+    memcpy(&crc, in + len - sizeof(crc), sizeof(crc));
+    len -= sizeof(crc);
+    if (crc32(in, len) != crc) {
+        return false;
+    }
+    size_t pos = 5;
+    uint64_t count;
+    if (!tagCodecGetVarint(in, len, pos, count) || count > capacity) {
+        return false;
+    }
+    uint64_t value = 0;
+    for (size_t i = 0; i < count; i++) {
+        uint64_t delta;
+        if (!tagCodecGetVarint(in, len, pos, delta)) {
+            return false;
+        }
+        value += delta;
+        values[i] = value;
+    }
+    n = (size_t)count;
+    return pos == len;
+}
+
+#endif // SC_TAG_CODEC_H
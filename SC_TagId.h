@@ -0,0 +1,74 @@
+// SC_TagId.h
+// Fixed-size card tag value: the exact bytes a tag occupies in the tag table, so lookups compare
+// storage directly and nothing on the tag path touches the heap.
+#ifndef SC_TAG_ID_H
+#define SC_TAG_ID_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <type_traits>
+
+#define TAG_ID_LEN 11
+
+struct TagId {
+    char digits[TAG_ID_LEN]; // Left-padded with '0', not terminated
+
+    // The one normalising parser for every input path (JSON body, UDP frame, reader).
+    // Shorter tags are left-padded with '0'; empty and longer ones are rejected.
+    static bool parse(const char* text, size_t len, TagId& out) {
+        if (len == 0 || len > TAG_ID_LEN) {
+            return false;
+        }
+        memset(out.digits, '0', TAG_ID_LEN - len);
+        memcpy(out.digits + (TAG_ID_LEN - len), text, len);
+        return true;
+    }
+
+    // nullptr (no such field) is rejected like an empty tag
+    static bool parse(const char* text, TagId& out) {
+        return text != nullptr && parse(text, strlen(text), out);
+    }
+
+    // Constant time, so response timing does not reveal how much of a guessed tag matched
+    bool operator==(const TagId& other) const {
+        uint8_t diff = 0;
+        for (int i = 0; i < TAG_ID_LEN; i++) {
+            diff |= digits[i] ^ other.digits[i];
+        }
+        return diff == 0;
+    }
+
+    bool operator!=(const TagId& other) const { return !(*this == other); }
+
+    // Unwritten (0xFF) or cleared (0x00) slot
+    bool isBlank() const {
+        return (uint8_t)digits[0] == 0xFF || digits[0] == '\0';
+    }
+
+    // Padded form, NUL-terminated
+    void format(char out[TAG_ID_LEN + 1]) const {
+        memcpy(out, digits, TAG_ID_LEN);
+        out[TAG_ID_LEN] = '\0';
+    }
+
+    // Leading zeros stripped, as get_tags lists tags; returns the length written
+    size_t formatTrimmed(char out[TAG_ID_LEN + 1]) const {
+        size_t skip = 0;
+        while (skip < TAG_ID_LEN && digits[skip] == '0') {
+            skip++;
+        }
+        size_t len = 0;
+        while (skip + len < TAG_ID_LEN && digits[skip + len] != '\0') {
+            len++;
+        }
+        memcpy(out, digits + skip, len);
+        out[len] = '\0';
+        return len;
+    }
+};
+
+static_assert(std::is_trivially_copyable<TagId>::value && sizeof(TagId) == TAG_ID_LEN,
+              "TagId is copied to and from storage as raw bytes");
+
+#endif // SC_TAG_ID_H
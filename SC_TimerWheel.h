@@ -0,0 +1,125 @@
+// SC_TimerWheel.h
+// Hierarchical timer wheel with a fixed pool of timers and one-second ticks: four levels of 64
+// slots cover about 194 days. A tick only touches the slot that is due (plus, every 64th tick,
+// one cascading slot), so the cost per tick does not grow with the number of armed timers.
+#ifndef SC_TIMER_WHEEL_H
+#define SC_TIMER_WHEEL_H
+
+#include <stdint.h>
+
+#define WHEEL_LEVELS 4
+#define WHEEL_BITS 6
+#define WHEEL_SLOTS (1 << WHEEL_BITS)
+#define WHEEL_MASK (WHEEL_SLOTS - 1)
+#define WHEEL_MAX_DELAY ((1UL << (WHEEL_LEVELS * WHEEL_BITS)) - 1)
+
+template <uint8_t N>
+class TimerWheel {
+    static_assert(N < 127, "timer ids are stored as int8_t");
+
+public:
+    TimerWheel() { reset(0); }
+
+    void reset(uint32_t now) {
+        _now = now;
+        for (int l = 0; l < WHEEL_LEVELS; l++) {
+            for (int s = 0; s < WHEEL_SLOTS; s++) {
+                _head[l][s] = -1;
+            }
+        }
+        for (int i = 0; i < N; i++) {
+            _armed[i] = false;
+        }
+    }
+
+    uint32_t now() const { return _now; }
+    bool armed(uint8_t id) const { return _armed[id]; }
+
+    // Arms (or re-arms) timer id for time at; anything not in the future fires on the next tick
+    void schedule(uint8_t id, uint32_t at) {
+        cancel(id);
+        if ((int32_t)(at - _now) <= 0) {
+            at = _now + 1;
+        }
+        if (at - _now > WHEEL_MAX_DELAY) {
+            at = _now + WHEEL_MAX_DELAY;
+        }
+        _expires[id] = at;
+        insert(id);
+    }
+
+    void cancel(uint8_t id) {
+        if (!_armed[id]) {
+            return;
+        }
+        if (_prev[id] >= 0) {
+            _next[_prev[id]] = _next[id];
+        } else {
+            _head[_level[id]][_slot[id]] = _next[id];
+        }
+        if (_next[id] >= 0) {
+            _prev[_next[id]] = _prev[id];
+        }
+        _armed[id] = false;
+    }
+
+    // Advances one second and calls fire(id) for every timer due at the new time.
+    // fire may re-arm the timer it is given (or any other).
+    template <typename F>
+    void tick(F fire) {
+        _now++;
+        uint32_t t = _now;
+        for (int l = 1; l < WHEEL_LEVELS && (t & WHEEL_MASK) == 0; l++) {
+            t >>= WHEEL_BITS;
+            cascade(l, t & WHEEL_MASK);
+        }
+        int8_t* slot = &_head[0][_now & WHEEL_MASK];
+        while (*slot >= 0) {
+            uint8_t id = *slot;
+            cancel(id);
+            fire(id);
+        }
+    }
+
+private:
+    void insert(uint8_t id) {
+        uint32_t delta = _expires[id] - _now;
+        uint8_t level = 0;
+        while (level < WHEEL_LEVELS - 1 && delta >= (1UL << (WHEEL_BITS * (level + 1)))) {
+            level++;
+        }
+        uint8_t slot = (_expires[id] >> (WHEEL_BITS * level)) & WHEEL_MASK;
+        _level[id] = level;
+        _slot[id] = slot;
+        _prev[id] = -1;
+        _next[id] = _head[level][slot];
+        if (_next[id] >= 0) {
+            _prev[_next[id]] = id;
+        }
+        _head[level][slot] = id;
+        _armed[id] = true;
+    }
+
+    // Moves every timer of a higher-level slot down now that its span has started
+    void cascade(int level, int slot) {
+        int8_t id = _head[level][slot];
+        _head[level][slot] = -1;
+        while (id >= 0) {
+            int8_t next = _next[id];
+            _armed[id] = false;
+            insert(id);
+            id = next;
+        }
+    }
+
+    uint32_t _now = 0;
+    int8_t _head[WHEEL_LEVELS][WHEEL_SLOTS];
+    int8_t _next[N];
+    int8_t _prev[N];
+    uint32_t _expires[N];
+    uint8_t _level[N];
+    uint8_t _slot[N];
+    bool _armed[N] = {};
+};
+
+#endif // SC_TIMER_WHEEL_H
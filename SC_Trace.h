@@ -0,0 +1,85 @@
+// SC_Trace.h
+// Hot-path trace facility: begin/end events stamped with the CPU cycle counter into a fixed
+// RAM ring buffer, dumped as Chrome trace JSON (chrome://tracing, Perfetto) from /api/trace.
+// Build with -DSC_TRACE_ENABLED (build_flags) to compile it in; otherwise every
+// SC_TRACE_SCOPE() compiles to nothing and no RAM is reserved.
+#ifndef SC_TRACE_H
+#define SC_TRACE_H
+
+#include <Arduino.h>
+
+#ifdef SC_TRACE_ENABLED
+
+#ifndef SC_TRACE_EVENTS
+#define SC_TRACE_EVENTS 256 // Ring size; 12 bytes per event
+#endif
+
+struct TraceEvent {
+    uint32_t cycles;
+    uint16_t wraps; // Cycle counter overflows before this event (every ~53 s at 80 MHz)
+    char phase;     // 'B' or 'E'
+    const char* name; // Must point to static storage (literals, route table paths)
+};
+
+class TraceBuffer {
+public:
+    inline void record(const char* name, char phase) {
+        if (_paused) {
+            return;
+        }
+        uint32_t cycles = ESP.getCycleCount();
+        if (cycles < _lastCycles) {
+            _wraps++;
+        }
+        _lastCycles = cycles;
+        TraceEvent& e = _events[_head];
+        e.cycles = cycles;
+        e.wraps = _wraps;
+        e.phase = phase;
+        e.name = name;
+        _head = (_head + 1) % SC_TRACE_EVENTS;
+        if (_count < SC_TRACE_EVENTS) {
+            _count++;
+        }
+    }
+
+    void pause(bool paused) { _paused = paused; }
+    void clear() { _count = 0; _head = 0; }
+    size_t count() const { return _count; }
+
+    // Oldest first
+    const TraceEvent& at(size_t i) const {
+        return _events[(_head + SC_TRACE_EVENTS - _count + i) % SC_TRACE_EVENTS];
+    }
+
+private:
+    TraceEvent _events[SC_TRACE_EVENTS];
+    size_t _head = 0;
+    size_t _count = 0;
+    uint32_t _lastCycles = 0;
+    uint16_t _wraps = 0;
+    bool _paused = false;
+};
+
+extern TraceBuffer scTrace;
+
+class TraceScope {
+public:
+    explicit TraceScope(const char* name) : _name(name) { scTrace.record(name, 'B'); }
+    ~TraceScope() { scTrace.record(_name, 'E'); }
+
+private:
+    const char* _name;
+};
+
+#define SC_TRACE_CONCAT_(a, b) a##b
+#define SC_TRACE_CONCAT(a, b) SC_TRACE_CONCAT_(a, b)
+#define SC_TRACE_SCOPE(name) TraceScope SC_TRACE_CONCAT(_traceScope, __LINE__)(name)
+
+#else
+
+#define SC_TRACE_SCOPE(name) do {} while (0)
+
+#endif // SC_TRACE_ENABLED
+
+#endif // SC_TRACE_H
@@ -0,0 +1,118 @@
+// SC_Wiegand.h
+// Wiegand 26/34 reader input: the D0/D1 interrupts only timestamp bits into an SPSC ring; the
+// main loop feeds them to WiegandDecoder, which frames on the inter-frame gap, checks parity and
+// suppresses repeated reads of the same card.
+// Plain C++ (no Arduino dependencies) so decoding can be replayed on a host from recorded (bit, microseconds) pulses.
+#ifndef SC_WIEGAND_H
+#define SC_WIEGAND_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "SC_SpscRing.h"
+#include "SC_TagId.h"
+
+#define WIEGAND_RING_SIZE 128       // Pulses buffered between loop() passes (a 34-bit frame is 34)
+#define WIEGAND_FRAME_GAP_US 25000  // Readers space bits ~2 ms apart; a longer silence ends a frame
+#define WIEGAND_REPEAT_MS 2000      // The same card read again within this window is ignored
+#define WIEGAND_MAX_BITS 34         // Longest frame accepted; the bit count stops one past it
+
+struct WiegandPulse {
+    uint32_t us;
+    uint8_t bit;
+};
+
+typedef SpscRing<WiegandPulse, WIEGAND_RING_SIZE> WiegandRing;
+
+class WiegandDecoder {
+public:
+    // Feeds one pulse in arrival order. Returns true with the card number (payload without
+    // parity bits) when this pulse's gap closed a valid frame.
+    bool push(const WiegandPulse& pulse, uint32_t& card) {
+        bool done = false;
+        if (_bits > 0 && pulse.us - _lastUs > WIEGAND_FRAME_GAP_US) {
+            done = finish(card);
+        }
+        // Saturates, so a noise burst of 256+ pulses cannot wrap back to a valid length
+        if (_bits <= WIEGAND_MAX_BITS) {
+            _raw = (_raw << 1) | (pulse.bit & 1);
+            _bits++;
+        }
+        _lastUs = pulse.us;
+        return done;
+    }
+
+    // Closes the frame in progress once nowUs is a full gap past its last bit
+    bool poll(uint32_t nowUs, uint32_t& card) {
+        return _bits > 0 && nowUs - _lastUs > WIEGAND_FRAME_GAP_US && finish(card);
+    }
+
+    uint32_t rejected() const { return _rejected; } // Frames with a bad length or parity
+
+private:
+    bool finish(uint32_t& card) {
+        uint8_t n = _bits;
+        uint64_t raw = _raw;
+        _bits = 0;
+        _raw = 0;
+        if (n != 26 && n != 34) {
+            _rejected++;
+            return false;
+        }
+        uint8_t half = (n - 2) / 2;
+        uint64_t data = (raw >> 1) & ((1ULL << (n - 2)) - 1);
+        uint8_t leading = (raw >> (n - 1)) & 1;
+        uint8_t trailing = raw & 1;
+        // Leading bit: even parity over the first half of the payload; trailing: odd over the second
+        if ((parity(data >> half) ^ leading) != 0 || (parity(data & ((1ULL << half) - 1)) ^ trailing) != 1) {
+            _rejected++;
+            return false;
+        }
+        card = (uint32_t)data;
+        return true;
+    }
+
+    static uint8_t parity(uint64_t v) {
+        uint8_t p = 0;
+        while (v) {
+            p ^= 1;
+            v &= v - 1;
+        }
+        return p;
+    }
+
+    uint64_t _raw = 0;
+    uint8_t _bits = 0;
+    uint32_t _lastUs = 0;
+    uint32_t _rejected = 0;
+};
+
+// Drops a card read that repeats the previous one within WIEGAND_REPEAT_MS
+class WiegandDebounce {
+public:
+    bool accept(uint32_t card, uint32_t nowMs) {
+        if (_seen && card == _lastCard && nowMs - _lastMs < WIEGAND_REPEAT_MS) {
+            _lastMs = nowMs;
+            return false;
+        }
+        _seen = true;
+        _lastCard = card;
+        _lastMs = nowMs;
+        return true;
+    }
+
+private:
+    uint32_t _lastCard = 0;
+    uint32_t _lastMs = 0;
+    bool _seen = false;
+};
+
+// Card number as a tag: decimal, left-padded like every other input path
+inline TagId wiegandTag(uint32_t card) {
+    char text[TAG_ID_LEN + 1];
+    int len = snprintf(text, sizeof(text), "%lu", (unsigned long)card);
+    TagId tag;
+    TagId::parse(text, len, tag); // A 32-bit value has at most 10 digits
+    return tag;
+}
+
+#endif // SC_WIEGAND_H
@@ -0,0 +1,158 @@
+// bench_keepalive.cpp
+// Requests per second for small API calls with a new connection per request (as before
+// keep-alive) and with one persistent connection, from a client that sends each request as soon
+// as the previous answer is in. Also a management tool polling four endpoints once a second,
+// which shows what HTTP_KEEPALIVE_IDLE_MS does between bursts. Last, the heap per check_tag as
+// its body grows: parseJsonBody() copies the body into a member that keeps its capacity.
+//
+// Device time is host CPU time scaled by HOST_CPU_SCALE (default 1 here: the server's parsing
+// and the handlers are all these calls cost), the modeled EEPROM bus, and a per-connection cost
+// for the lwIP handshake and teardown, which the host cannot measure. It is swept instead:
+//
+//   bench_keepalive [connection cost us ...]     0 1000 5000 by default
+#include "host_device.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+namespace {
+
+const int kRequests = 320; // 10 persistent connections' worth at HTTP_KEEPALIVE_MAX_REQUESTS
+
+struct Run {
+    double rps;
+    uint32_t connections;
+};
+
+// Closed loop: each request is sent once the previous one is answered
+Run closedLoop(const std::string& raw, bool keepAlive) {
+    Run run = {0, 0};
+    host::ConnectionPtr c;
+    uint16_t port = 41000;
+    uint64_t start = host::nowUs();
+    for (int i = 0; i < kRequests; i++) {
+        if (!keepAlive || !c || !c->open()) {
+            if (c) {
+                c->clientClosed = true;
+            }
+            c = server.hostConnect(IPAddress(192, 168, 4, 20), port++, host::nowUs());
+            run.connections++;
+        }
+        size_t answered = c->responses.size();
+        c->send(raw, host::nowUs());
+        while (c->responses.size() == answered && !(c->serverClosed)) {
+            host::loopOnce(0);
+        }
+        if (c->responses.size() == answered) {
+            fprintf(stderr, "request %d went unanswered\n", i);
+            exit(1);
+        }
+    }
+    run.rps = kRequests * 1e6 / (host::nowUs() - start);
+    c->clientClosed = true;
+    while (server.hostServing()) {
+        host::loopOnce();
+    }
+    return run;
+}
+
+// Four GETs back to back once a second for 30 s, on a kept-alive connection where the server allows
+Run pollBursts(uint64_t& burstUs) {
+    static const char* const kUris[] = {"/api/relay/get_state", "/api/users/get_count", "/api/time/get",
+                                        "/api/op_method"};
+    Run run = {0, 0};
+    host::ConnectionPtr c;
+    uint16_t port = 42000;
+    uint64_t total = 0;
+    const int bursts = 30;
+    for (int b = 0; b < bursts; b++) {
+        uint64_t burstStart = host::nowUs();
+        for (const char* uri : kUris) {
+            if (!c || !c->open()) {
+                c = server.hostConnect(IPAddress(192, 168, 4, 20), port++, host::nowUs());
+                run.connections++;
+            }
+            size_t answered = c->responses.size();
+            c->send(host::httpRequest("GET", uri), host::nowUs());
+            while (c->responses.size() == answered && !c->serverClosed) {
+                host::loopOnce(0);
+            }
+        }
+        total += host::nowUs() - burstStart;
+        while (host::nowUs() < burstStart + 1000000) {
+            host::loopOnce(1000);
+        }
+    }
+    c->clientClosed = true;
+    while (server.hostServing()) {
+        host::loopOnce();
+    }
+    burstUs = total / bursts;
+    return run;
+}
+
+// Allocations, peak and retained heap of single check_tag requests, in order
+void bodyCopy() {
+    const std::string tag = "{\"tag\":\"1000000019\"}";
+    const std::string padded = "{\"tag\":\"1000000019\"" + std::string(180, ' ') + "}";
+    const std::string* const kBodies[] = {&tag, &tag, &padded, &padded, &tag};
+    printf("\n%-34s %8s %10s %10s\n", "check_tag, in this order", "allocs", "heap peak", "heap +/-");
+    for (const std::string* body : kBodies) {
+        host::HeapStats before = host::heap();
+        host::resetHeapPeak();
+        host::exchange("POST", "/api/users/check_tag", *body);
+        host::HeapStats after = host::heap();
+        printf("%4zu-byte body %19s %8u %10zu %10ld\n", body->size(), "", after.allocations - before.allocations,
+               after.peak - before.live, (long)after.live - (long)before.live);
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::vector<uint64_t> costs;
+    for (int i = 1; i < argc; i++) {
+        costs.push_back(strtoull(argv[i], nullptr, 10));
+    }
+    if (costs.empty()) {
+        costs = {0, 1000, 5000};
+    }
+    const char* scale = getenv("HOST_CPU_SCALE");
+    double cpuScale = scale ? atof(scale) : 1.0;
+    host::setCpuScale(cpuScale);
+
+    host::bootDevice();
+    host::exchange("POST", "/api/users/delete_all_tags");
+    host::loadTags(20);
+    host::advanceUs(10000000);
+
+    const std::string getState = host::httpRequest("GET", "/api/relay/get_state");
+    const std::string checkTag = host::httpRequest("POST", "/api/users/check_tag", "{\"tag\":\"1000000019\"}");
+    printf("keep-alive bench: %d requests per run, cap %d per connection, idle timeout %d ms, cpu scale %g\n\n",
+           kRequests, HTTP_KEEPALIVE_MAX_REQUESTS, HTTP_KEEPALIVE_IDLE_MS, cpuScale);
+    printf("%-10s %-24s %12s %12s %8s %12s\n", "conn cost", "request", "close req/s", "k-a req/s", "k-a conns",
+           "poll burst");
+    for (uint64_t cost : costs) {
+        host::setConnectionCostUs(cost);
+        const struct {
+            const char* name;
+            const std::string& raw;
+        } kCalls[] = {{"get_state", getState}, {"check_tag (20 tags)", checkTag}};
+        uint64_t burstUs = 0;
+        Run poll = pollBursts(burstUs);
+        for (const auto& call : kCalls) {
+            Run close = closedLoop(call.raw, false);
+            Run kept = closedLoop(call.raw, true);
+            printf("%7.1f ms %-24s %12.1f %12.1f %8u", cost / 1000.0, call.name, close.rps, kept.rps, kept.connections);
+            if (&call == &kCalls[0]) {
+                printf(" %6.2f ms/%u", burstUs / 1000.0, poll.connections);
+            }
+            printf("\n");
+        }
+    }
+    printf("\npoll burst: mean time for four GETs, and connections opened over 30 bursts\n");
+    host::setConnectionCostUs(0);
+    bodyCopy();
+    return 0;
+}
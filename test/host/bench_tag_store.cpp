@@ -0,0 +1,152 @@
+// bench_tag_store.cpp
+// Tag store cost at a given table size on the modeled 24C256: findUserTagAddress, storeTag,
+// DeleteTag and /api/users/get_tags. Times are device time charged by the bus model (START,
+// address, 9 clocks per byte at the Wire clock, tWR per page write), plus host CPU time scaled
+// by HOST_CPU_SCALE (default 0, so the numbers are the bus cost alone and repeatable).
+//
+//   bench_tag_store [tags]     300 by default; above 300 needs the bench-large build
+#include "host_device.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+namespace {
+
+size_t runPeak = 0; // Highest live heap seen by any probe
+
+struct Sample {
+    uint64_t us;
+    host::I2cStats bus;
+    long heapDelta;   // Live heap after minus before
+    size_t heapPeak;  // Peak above the live heap at the start
+};
+
+class Probe {
+public:
+    Probe() {
+        host::resetI2cStats();
+        host::resetHeapPeak();
+        _live = host::heap().live;
+        _start = host::nowUs();
+    }
+    Sample take() const {
+        Sample s;
+        s.us = host::nowUs() - _start;
+        s.bus = host::i2cStats();
+        host::HeapStats h = host::heap();
+        s.heapDelta = (long)h.live - (long)_live;
+        s.heapPeak = h.peak - _live;
+        runPeak = h.peak > runPeak ? h.peak : runPeak;
+        return s;
+    }
+
+private:
+    uint64_t _start;
+    size_t _live;
+};
+
+void print(const char* name, const Sample& s) {
+    printf("%-26s %10.3f %7u %9u %9u %7u %6u %9ld %9zu\n", name, s.us / 1000.0, s.bus.transactions,
+           s.bus.bytesRead, s.bus.bytesWritten, s.bus.writeCycles, s.bus.nackPolls, s.heapDelta, s.heapPeak);
+}
+
+TagId tagFor(uint64_t n) {
+    char text[24];
+    snprintf(text, sizeof(text), "%llu", (unsigned long long)n);
+    TagId tag;
+    TagId::parse(text, tag);
+    return tag;
+}
+
+Sample find(const TagId& tag, int expect) {
+    Probe p;
+    int address = users.findUserTagAddress(tag);
+    Sample s = p.take();
+    if (address != expect) {
+        fprintf(stderr, "findUserTagAddress returned %d, expected %d\n", address, expect);
+        exit(1);
+    }
+    return s;
+}
+
+Sample getTags(uint64_t& handlerUs) {
+    host::advanceUs(10000000); // Let the heavy-request bucket refill between requests
+    Probe p;
+    host::HttpResponse r = host::exchange("GET", "/api/users/get_tags");
+    Sample s = p.take();
+    if (r.code != 200) {
+        fprintf(stderr, "get_tags answered %d: %s\n", r.code, r.body.c_str());
+        exit(1);
+    }
+    handlerUs = r.completedUs - r.startedUs;
+    return s;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int tags = argc > 1 ? atoi(argv[1]) : 300;
+    const char* scale = getenv("HOST_CPU_SCALE");
+    double cpuScale = scale ? atof(scale) : 0.0;
+    host::setCpuScale(cpuScale);
+    if (tags < 3 || tags > USER_TAG_CAPACITY || USER_TAGS_START_ADDR + 2 * tags * USER_TAG_LEN > EX_EEPROM_SIZE) {
+        fprintf(stderr, "%d tags do not fit this build (USER_TAG_CAPACITY %d, EX_EEPROM_SIZE %d)\n", tags,
+                USER_TAG_CAPACITY, (int)EX_EEPROM_SIZE);
+        return 2;
+    }
+
+    host::bootDevice(tags);
+    const uint64_t base = 1000000000ULL;
+    host::resetI2cStats();
+    uint64_t loadStart = host::nowUs();
+    if (!host::loadTags(tags, base)) {
+        fprintf(stderr, "replace_tags rejected %d tags\n", tags);
+        return 1;
+    }
+    host::I2cStats load = host::i2cStats();
+
+    printf("tag store bench: %d tags, %d-byte EEPROM (%d-byte pages), Wire at 100 kHz, tWR 5 ms, cpu scale %g\n",
+           tags, HOST_EEPROM_BYTES, HOST_EEPROM_PAGE, cpuScale);
+    printf("bulk load (replace_tags): %.1f ms, %u transactions, %u write cycles\n\n",
+           (host::nowUs() - loadStart) / 1000.0, load.transactions, load.writeCycles);
+    printf("%-26s %10s %7s %9s %9s %7s %6s %9s %9s\n", "operation", "ms", "xfers", "rd bytes", "wr bytes",
+           "cycles", "nacks", "heap +/-", "heap peak");
+
+    print("findUserTagAddress first", find(tagFor(base), 0));
+    print("findUserTagAddress last", find(tagFor(base + tags - 1), tags - 1));
+    print("findUserTagAddress miss", find(tagFor(base + tags), -1));
+
+    // Each delete is followed by a store of the same tag, which appends it at the end again
+    const int positions[] = {0, tags / 2, tags - 1};
+    const char* deleteNames[] = {"DeleteTag first", "DeleteTag middle", "DeleteTag last"};
+    const char* storeNames[] = {"storeTag (after first)", "storeTag (after middle)", "storeTag (after last)"};
+    for (int i = 0; i < 3; i++) {
+        TagId tag = users.readTag(users.tagAddress(positions[i]));
+        Probe del;
+        bool deleted = users.DeleteTag(tag);
+        print(deleteNames[i], del.take());
+        host::advanceUs(10000); // Past tWR, so the store does not start on a busy part
+        Probe store;
+        bool stored = users.storeTag(tag);
+        print(storeNames[i], store.take());
+        host::advanceUs(10000);
+        if (!deleted || !stored || users.findUserTagAddress(tag) != tags - 1) {
+            fprintf(stderr, "delete/store round trip failed at slot %d\n", positions[i]);
+            return 1;
+        }
+    }
+
+    uint64_t handlerUs = 0;
+    Sample cold = getTags(handlerUs);
+    print("get_tags (built)", cold);
+    printf("%-26s %10.3f\n", "  handler only", handlerUs / 1000.0);
+    Sample warm = getTags(handlerUs);
+    print("get_tags (cached)", warm);
+    printf("%-26s %10.3f\n", "  handler only", handlerUs / 1000.0);
+    printf("\nfree heap after the run: %u of %d bytes (peak use %zu)\n", ESP.getFreeHeap(), HOST_HEAP_BYTES,
+           runPeak);
+    if (runPeak > HOST_HEAP_BYTES) {
+        printf("peak use exceeds the device heap: on an ESP8266 these allocations fail\n");
+    }
+    return 0;
+}
@@ -0,0 +1,69 @@
+// host_device.cpp
+#include "host_device.h"
+
+WebServer server(80);
+UserManagementClass users(server, RELAY_PIN);
+
+namespace {
+uint16_t nextPort = 40000;
+}
+
+void host::bootDevice(int maxTags) {
+    users.MAX_USER_TAGS = maxTags;
+    users.beginAPAndWebServer("SCLib-host", "host-pass");
+    users.setupUserEndpoints();
+}
+
+void host::loopOnce(uint64_t idleUs) {
+    uint64_t before = nowUs();
+    users.handleClient();
+    if (nowUs() < before + idleUs) {
+        advanceUs(before + idleUs - nowUs());
+    }
+}
+
+host::HttpResponse host::exchange(const std::string& raw, uint64_t timeoutUs) {
+    ConnectionPtr c = server.hostConnect(IPAddress(192, 168, 4, 2), nextPort++, nowUs());
+    c->send(raw, nowUs());
+    uint64_t deadline = nowUs() + timeoutUs;
+    while (c->responses.empty() && nowUs() < deadline) {
+        loopOnce();
+    }
+    c->clientClosed = true; // One request per connection, as curl sends them
+    while (server.hostServing()) {
+        loopOnce();
+    }
+    HeapExempt exempt; // The test's copy is not on the device heap
+    return c->responses.empty() ? HttpResponse() : c->responses.front();
+}
+
+host::HttpResponse host::exchange(const char* method, const char* uri, const std::string& body, const char* contentType) {
+    return exchange(httpRequest(method, uri, body, contentType));
+}
+
+std::string host::multipartRequest(const char* uri, const std::string& content, const char* filename, const char* extraHeaders) {
+    HeapExempt exempt;
+    const std::string boundary = "----sclibhostboundary";
+    std::string body = "--" + boundary + "\r\n";
+    body += "Content-Disposition: form-data; name=\"file\"; filename=\"" + std::string(filename) + "\"\r\n";
+    body += "Content-Type: application/octet-stream\r\n\r\n";
+    body += content;
+    body += "\r\n--" + boundary + "--\r\n";
+    return httpRequest("POST", uri, body, ("multipart/form-data; boundary=" + boundary).c_str(), extraHeaders);
+}
+
+std::string host::tagList(int count, uint64_t base) {
+    HeapExempt exempt;
+    std::string list;
+    list.reserve((size_t)count * 11);
+    for (int i = 0; i < count; i++) {
+        list += std::to_string(base + i);
+        list += '\n';
+    }
+    return list;
+}
+
+bool host::loadTags(int count, uint64_t base) {
+    HttpResponse r = exchange(multipartRequest("/api/users/replace_tags", tagList(count, base), "tags.txt"));
+    return r.code == 200;
+}
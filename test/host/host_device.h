@@ -0,0 +1,42 @@
+// host_device.h
+// The device the host tests and benches run against: the sketch's global WebServer and
+// UserManagementClass on the stand-in platform, and a client that sends one request at a time
+// and runs the device loop until the response is back.
+#ifndef HOST_DEVICE_H
+#define HOST_DEVICE_H
+
+#include "SC_Library.h"
+#include "host_platform.h"
+#include "host_net.h"
+
+#include <string>
+
+extern WebServer server;
+extern UserManagementClass users;
+
+namespace host {
+
+// Sets MAX_USER_TAGS, then boots as a sketch's setup() would
+void bootDevice(int maxTags = 300);
+
+// Runs users.handleClient() once; the clock moves by at least idleUs so timeouts can expire
+void loopOnce(uint64_t idleUs = 100);
+
+// Sends one request on its own connection and loops until it is answered (or timeoutUs passes)
+HttpResponse exchange(const std::string& raw, uint64_t timeoutUs = 30000000);
+HttpResponse exchange(const char* method, const char* uri, const std::string& body = std::string(),
+                      const char* contentType = "application/json");
+
+// A multipart/form-data body with one file field, as a browser uploads it
+std::string multipartRequest(const char* uri, const std::string& content, const char* filename = "upload.bin",
+                             const char* extraHeaders = "");
+
+// "<base+i>\n" for i in [0, count): numeric tags for bulk loads
+std::string tagList(int count, uint64_t base = 1000000000ULL);
+
+// Loads the tag table through /api/users/replace_tags; false unless the device accepted it
+bool loadTags(int count, uint64_t base = 1000000000ULL);
+
+} // namespace host
+
+#endif // HOST_DEVICE_H
@@ -0,0 +1,240 @@
+// host_load.cpp
+#include "host_load.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <random>
+#include <string>
+
+namespace {
+
+const uint64_t kStoredBase = 1000000000ULL; // Tags loaded before the run
+const uint64_t kMissBase = 5000000000ULL;   // Never stored
+const uint64_t kAddBase = 7000000000ULL;    // add_tag, one new tag per request
+const uint64_t kDrainUs = 120000000;        // After the last arrival, answers are waited for this long
+
+struct Arrival {
+    uint64_t us;
+    int route;
+    std::string raw;
+};
+
+// A client in keep-alive mode: sends its next request once the previous one is answered, on the
+// connection it has open, and reconnects when the server has closed it. A request the server
+// dropped unread with the connection is sent again on a new one, as curl and browsers do.
+struct Client {
+    host::ConnectionPtr connection;
+    std::deque<size_t> waiting;
+    bool busy = false;
+    size_t inFlight = 0;
+};
+
+struct Open {
+    host::ConnectionPtr connection;
+    size_t consumed;
+    int client; // -1: one request per connection
+};
+
+std::string tagBody(uint64_t tag) { return "{\"tag\":\"" + std::to_string(tag) + "\"}"; }
+
+std::vector<Arrival> schedule(const host::LoadConfig& config, uint64_t startUs) {
+    std::mt19937_64 rng(config.seed);
+    std::exponential_distribution<double> gap(config.rate);
+    std::discrete_distribution<int> route(config.mix, config.mix + host::LOAD_ROUTES);
+    std::uniform_real_distribution<double> unit(0, 1);
+    std::vector<Arrival> arrivals;
+    uint64_t added = 0;
+    for (double t = gap(rng); t < config.seconds; t += gap(rng)) {
+        Arrival a;
+        a.us = startUs + (uint64_t)(t * 1e6);
+        a.route = route(rng);
+        uint64_t tag = unit(rng) < config.hit && config.tags > 0 ? kStoredBase + rng() % config.tags
+                                                                 : kMissBase + rng() % 1000000000ULL;
+        switch (a.route) {
+        case host::LOAD_USE_TAG: a.raw = host::httpRequest("POST", "/api/users/use_tag", tagBody(tag)); break;
+        case host::LOAD_CHECK_TAG: a.raw = host::httpRequest("POST", "/api/users/check_tag", tagBody(tag)); break;
+        case host::LOAD_ADD_TAG: a.raw = host::httpRequest("POST", "/api/users/add_tag", tagBody(kAddBase + added++)); break;
+        default: a.raw = host::httpRequest("GET", "/api/users/get_tags"); break;
+        }
+        arrivals.push_back(a);
+    }
+    return arrivals;
+}
+
+} // namespace
+
+double host::LoadRouteStats::percentileMs(double p) const {
+    if (latencyUs.empty()) {
+        return 0;
+    }
+    size_t rank = (size_t)ceil(p * latencyUs.size());
+    return latencyUs[rank > 0 ? rank - 1 : 0] / 1000.0;
+}
+
+double host::LoadReport::throughput() const {
+    return lastCompletedUs > firstArrivalUs ? answered * 1e6 / (lastCompletedUs - firstArrivalUs) : 0;
+}
+
+const char* host::loadRouteName(int route) {
+    static const char* const kNames[] = {"use_tag", "check_tag", "add_tag", "get_tags"};
+    return route >= 0 && route < LOAD_ROUTES ? kNames[route] : "?";
+}
+
+host::LoadReport host::runLoad(const LoadConfig& config) {
+    exchange("POST", "/api/users/delete_all_tags");
+    if (config.tags > 0 && !loadTags(config.tags, kStoredBase)) {
+        fprintf(stderr, "replace_tags refused %d tags\n", config.tags);
+    }
+    advanceUs(10000000); // Let the heavy-request bucket refill after the load
+
+    // The harness's own bookkeeping is kept off the device heap; only users.handleClient() is counted
+    std::unique_ptr<HeapExempt> exempt(new HeapExempt());
+    LoadReport report;
+    std::vector<Arrival> arrivals = schedule(config, nowUs());
+    std::vector<Open> open;
+    Client clients[2]; // Keep-alive mode: the door reader and the admin tool
+    uint16_t nextPort = 50000;
+    size_t next = 0, outstanding = 0;
+    report.firstArrivalUs = arrivals.empty() ? nowUs() : arrivals.front().us;
+    uint64_t drainUntil = (arrivals.empty() ? nowUs() : arrivals.back().us) + kDrainUs;
+
+    auto connect = [&](int client, uint64_t atUs, bool persistent) {
+        IPAddress ip = client == 1 ? IPAddress(192, 168, 4, 20) : IPAddress(192, 168, 4, 10);
+        ConnectionPtr c = server.hostConnect(ip, nextPort++, atUs);
+        open.push_back(Open{c, 0, persistent ? client : -1});
+        return c;
+    };
+    auto sendNext = [&](int index) {
+        Client& client = clients[index];
+        if (client.busy || client.waiting.empty()) {
+            return;
+        }
+        if (!client.connection || !client.connection->open()) {
+            client.connection = connect(index, nowUs(), true);
+        }
+        size_t id = client.waiting.front();
+        client.waiting.pop_front();
+        client.connection->send(arrivals[id].raw, nowUs(), id); // Timed from arrivals[id].us all the same
+        client.busy = true;
+        client.inFlight = id;
+    };
+
+    while (next < arrivals.size() || (outstanding > 0 && nowUs() < drainUntil)) {
+        for (; next < arrivals.size() && arrivals[next].us <= nowUs(); next++) {
+            const Arrival& a = arrivals[next];
+            int client = a.route == LOAD_USE_TAG || a.route == LOAD_CHECK_TAG ? 0 : 1;
+            report.routes[a.route].sent++;
+            outstanding++;
+            if (config.keepAlive) {
+                clients[client].waiting.push_back(next);
+                sendNext(client);
+            } else {
+                connect(client, a.us, false)->send(a.raw, a.us, next);
+            }
+        }
+
+        // Idle until the next arrival, in steps short enough for the server's timeouts
+        uint64_t idle = 100;
+        if (!server.hostServing() && next < arrivals.size() && arrivals[next].us > nowUs()) {
+            idle = std::min<uint64_t>(std::max<uint64_t>(arrivals[next].us - nowUs(), 100), 10000);
+        }
+        exempt.reset();
+        loopOnce(idle);
+        exempt.reset(new HeapExempt());
+
+        for (size_t i = 0; i < open.size();) {
+            Open& o = open[i];
+            for (; o.consumed < o.connection->responses.size(); o.consumed++) {
+                const HttpResponse& r = o.connection->responses[o.consumed];
+                const Arrival& a = arrivals[r.tag];
+                LoadRouteStats& s = report.routes[a.route];
+                s.latencyUs.push_back(r.completedUs - a.us);
+                if (a.route == LOAD_USE_TAG || a.route == LOAD_CHECK_TAG) {
+                    report.access.latencyUs.push_back(r.completedUs - a.us);
+                }
+                if (r.code >= 200 && r.code < 300) {
+                    s.ok++;
+                } else if (r.code == 503) {
+                    s.rejected++;
+                } else {
+                    s.failed++;
+                }
+                report.answered++;
+                report.lastCompletedUs = std::max(report.lastCompletedUs, r.completedUs);
+                outstanding--;
+                if (o.client >= 0) {
+                    clients[o.client].busy = false;
+                }
+            }
+            // Closed by the server under a request: lost if it was the connection's only one,
+            // retried if it was dropped from a kept-alive connection for a waiting client
+            if (o.client < 0 && !o.connection->open() && o.consumed == 0) {
+                outstanding--;
+            } else if (o.client >= 0 && !o.connection->open() && clients[o.client].connection == o.connection &&
+                       clients[o.client].busy) {
+                Client& client = clients[o.client];
+                client.busy = false;
+                client.waiting.push_front(client.inFlight);
+                report.routes[arrivals[client.inFlight].route].retried++;
+            }
+            // One-shot connections hang up once answered; persistent ones when the server closes them
+            bool done = !o.connection->open() || (o.client < 0 && o.consumed > 0);
+            if (done) {
+                o.connection->clientClosed = true;
+                open.erase(open.begin() + i);
+            } else {
+                i++;
+            }
+        }
+        if (config.keepAlive) {
+            sendNext(0);
+            sendNext(1);
+        }
+    }
+
+    for (int route = 0; route < LOAD_ROUTES; route++) {
+        LoadRouteStats& s = report.routes[route];
+        s.lost = s.sent - s.ok - s.rejected - s.failed;
+        std::sort(s.latencyUs.begin(), s.latencyUs.end());
+        if (route == LOAD_USE_TAG || route == LOAD_CHECK_TAG) {
+            report.access.sent += s.sent;
+            report.access.ok += s.ok;
+            report.access.rejected += s.rejected;
+            report.access.failed += s.failed;
+            report.access.lost += s.lost;
+            report.access.retried += s.retried;
+        }
+    }
+    std::sort(report.access.latencyUs.begin(), report.access.latencyUs.end());
+
+    // Hang up on whatever is still open so the next run starts with a free server
+    for (const Open& o : open) {
+        o.connection->clientClosed = true;
+    }
+    exempt.reset();
+    while (server.hostServing()) {
+        loopOnce();
+    }
+    exempt.reset(new HeapExempt());
+    return report;
+}
+
+void host::printLoadReport(const LoadConfig& config, const LoadReport& report) {
+    printf("offered %.2f req/s for %.0f s, mix use_tag=%d check_tag=%d add_tag=%d get_tags=%d, %d tags, hit %.2f, %s\n",
+           config.rate, config.seconds, config.mix[0], config.mix[1], config.mix[2], config.mix[3], config.tags,
+           config.hit, config.keepAlive ? "keep-alive" : "one connection per request");
+    printf("%-12s %6s %6s %6s %6s %6s %6s %10s %10s %10s\n", "route", "sent", "2xx", "503", "other", "lost", "retry",
+           "p50 ms", "p99 ms", "max ms");
+    auto line = [](const char* name, const LoadRouteStats& s) {
+        printf("%-12s %6u %6u %6u %6u %6u %6u %10.1f %10.1f %10.1f\n", name, s.sent, s.ok, s.rejected, s.failed, s.lost,
+               s.retried, s.percentileMs(0.5), s.percentileMs(0.99), s.maxMs());
+    };
+    for (int route = 0; route < LOAD_ROUTES; route++) {
+        line(loadRouteName(route), report.routes[route]);
+    }
+    line("access lane", report.access);
+    printf("throughput %.2f req/s answered\n", report.throughput());
+}
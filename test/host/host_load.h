@@ -0,0 +1,60 @@
+// host_load.h
+// Open-loop HTTP load against the device's API: requests of a use_tag/check_tag/add_tag/get_tags
+// mix arrive at a target rate (Poisson, seeded) whether or not the server keeps up, and each is
+// timed from its arrival to the handler's return in device time. That includes the wait for the
+// single-client server, which is what a door reader sees.
+#ifndef HOST_LOAD_H
+#define HOST_LOAD_H
+
+#include "host_device.h"
+
+#include <stdint.h>
+#include <vector>
+
+namespace host {
+
+enum LoadRoute { LOAD_USE_TAG, LOAD_CHECK_TAG, LOAD_ADD_TAG, LOAD_GET_TAGS, LOAD_ROUTES };
+
+struct LoadConfig {
+    double rate = 2;      // Requests per second of device time, all routes together
+    double seconds = 60;  // Arrivals are generated for this long
+    int mix[LOAD_ROUTES] = {50, 30, 10, 10}; // Relative weights
+    int tags = 200;       // Loaded through replace_tags before the run
+    double hit = 0;       // Share of use_tag/check_tag for stored tags
+    bool keepAlive = false; // One persistent connection per client instead of one per request
+    uint32_t seed = 1;
+};
+
+struct LoadRouteStats {
+    uint32_t sent = 0;
+    uint32_t ok = 0;       // 2xx
+    uint32_t rejected = 0; // 503 from admission control
+    uint32_t failed = 0;   // Any other status
+    uint32_t lost = 0;     // No response before the drain timeout
+    uint32_t retried = 0;  // Resent after the server closed a kept-alive connection under it
+    std::vector<uint64_t> latencyUs; // Answered requests, sorted once the run ends
+
+    // Nearest rank; 0 with no samples
+    double percentileMs(double p) const;
+    double maxMs() const { return latencyUs.empty() ? 0 : latencyUs.back() / 1000.0; }
+};
+
+struct LoadReport {
+    LoadRouteStats routes[LOAD_ROUTES];
+    LoadRouteStats access; // use_tag and check_tag together: the access lane
+    uint64_t firstArrivalUs = 0;
+    uint64_t lastCompletedUs = 0;
+    uint32_t answered = 0;
+
+    double throughput() const; // Answered requests per second, first arrival to last answer
+};
+
+// Runs one load against the booted device (see bootDevice()) and returns what the clients saw
+LoadReport runLoad(const LoadConfig& config);
+void printLoadReport(const LoadConfig& config, const LoadReport& report);
+
+const char* loadRouteName(int route);
+
+} // namespace host
+
+#endif // HOST_LOAD_H
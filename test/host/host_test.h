@@ -0,0 +1,41 @@
+// host_test.h
+// Minimal checks for the host tests: a failed CHECK prints where and carries on, and
+// TEST_RESULT() turns the count into the exit status.
+#ifndef HOST_TEST_H
+#define HOST_TEST_H
+
+#include <stdio.h>
+#include <string>
+
+static int hostTestFailures = 0;
+
+#define CHECK(cond)                                                         \
+    do {                                                                    \
+        if (!(cond)) {                                                      \
+            fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+            hostTestFailures++;                                             \
+        }                                                                   \
+    } while (0)
+
+#define CHECK_EQ(a, b)                                                      \
+    do {                                                                    \
+        long long _a = (long long)(a), _b = (long long)(b);                 \
+        if (_a != _b) {                                                     \
+            fprintf(stderr, "%s:%d: CHECK_EQ failed: %s = %lld, %s = %lld\n", __FILE__, __LINE__, #a, _a, #b, _b); \
+            hostTestFailures++;                                             \
+        }                                                                   \
+    } while (0)
+
+#define CHECK_STR(a, b)                                                     \
+    do {                                                                    \
+        std::string _a = (a), _b = (b);                                     \
+        if (_a != _b) {                                                     \
+            fprintf(stderr, "%s:%d: CHECK_STR failed: %s = \"%s\", expected \"%s\"\n", __FILE__, __LINE__, #a, _a.c_str(), _b.c_str()); \
+            hostTestFailures++;                                             \
+        }                                                                   \
+    } while (0)
+
+#define TEST_RESULT(name)                                                   \
+    (printf("%s: %s\n", name, hostTestFailures ? "FAILED" : "ok"), hostTestFailures ? 1 : 0)
+
+#endif // HOST_TEST_H
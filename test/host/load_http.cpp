@@ -0,0 +1,97 @@
+// load_http.cpp
+// Replays a use_tag/check_tag/add_tag/get_tags mix against the API at a target rate and reports
+// p50/p99/max latency per route and the throughput the device sustained (see host_load.h).
+// Device time is the modeled bus, write-cycle and delay() cost plus host CPU time scaled by
+// HOST_CPU_SCALE (default 0, so runs are repeatable).
+//
+//   load_http [--rate 2] [--seconds 60] [--mix use_tag=50,check_tag=30,add_tag=10,get_tags=10]
+//             [--tags 200] [--hit 0] [--keep-alive] [--seed 1]
+//
+// --hit is the share of use_tag/check_tag for stored tags. A granted use_tag starts a door pulse
+// that handleClient() ends ACCESS_PULSE_MS later; the answer does not wait for it.
+#include "host_load.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace {
+
+bool parseMix(const char* text, int mix[host::LOAD_ROUTES]) {
+    int parsed[host::LOAD_ROUTES] = {0, 0, 0, 0};
+    while (*text) {
+        const char* eq = strchr(text, '=');
+        if (!eq) {
+            return false;
+        }
+        int route = -1;
+        for (int r = 0; r < host::LOAD_ROUTES; r++) {
+            const char* name = host::loadRouteName(r);
+            if (strlen(name) == (size_t)(eq - text) && strncmp(text, name, eq - text) == 0) {
+                route = r;
+            }
+        }
+        if (route < 0) {
+            return false;
+        }
+        char* end;
+        parsed[route] = (int)strtol(eq + 1, &end, 10);
+        text = *end == ',' ? end + 1 : end;
+        if (*end && *end != ',') {
+            return false;
+        }
+    }
+    memcpy(mix, parsed, sizeof(parsed));
+    return true;
+}
+
+int usage() {
+    fprintf(stderr, "usage: load_http [--rate R] [--seconds S] [--mix use_tag=N,check_tag=N,add_tag=N,get_tags=N]\n"
+                    "                 [--tags N] [--hit F] [--keep-alive] [--seed N]\n");
+    return 2;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    host::LoadConfig config;
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (strcmp(arg, "--keep-alive") == 0) {
+            config.keepAlive = true;
+            continue;
+        }
+        if (!value) {
+            return usage();
+        }
+        i++;
+        if (strcmp(arg, "--rate") == 0) {
+            config.rate = atof(value);
+        } else if (strcmp(arg, "--seconds") == 0) {
+            config.seconds = atof(value);
+        } else if (strcmp(arg, "--mix") == 0) {
+            if (!parseMix(value, config.mix)) {
+                return usage();
+            }
+        } else if (strcmp(arg, "--tags") == 0) {
+            config.tags = atoi(value);
+        } else if (strcmp(arg, "--hit") == 0) {
+            config.hit = atof(value);
+        } else if (strcmp(arg, "--seed") == 0) {
+            config.seed = (uint32_t)strtoul(value, nullptr, 10);
+        } else {
+            return usage();
+        }
+    }
+    if (config.rate <= 0 || config.seconds <= 0) {
+        return usage();
+    }
+    const char* scale = getenv("HOST_CPU_SCALE");
+    host::setCpuScale(scale ? atof(scale) : 0);
+
+    host::bootDevice();
+    host::LoadReport report = host::runLoad(config);
+    host::printLoadReport(config, report);
+    return 0;
+}
@@ -0,0 +1,533 @@
+// Arduino.cpp (host stand-in)
+#include "Arduino.h"
+#include "host_platform.h"
+
+#include <atomic>
+#include <cstddef>
+#include <chrono>
+#include <new>
+#include <thread>
+
+// --- Device clock ---
+
+static std::atomic<uint64_t> g_chargedUs{0};
+static double g_cpuScale = 1.0;
+static bool g_realtime = false;
+static std::chrono::steady_clock::time_point g_realStart = std::chrono::steady_clock::now();
+
+static uint64_t realElapsedUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - g_realStart).count();
+}
+
+uint64_t host::nowUs() {
+    if (g_realtime) {
+        return realElapsedUs();
+    }
+    return g_chargedUs.load(std::memory_order_relaxed) + (uint64_t)(realElapsedUs() * g_cpuScale);
+}
+
+void host::advanceUs(uint64_t us) {
+    if (g_realtime) {
+        std::this_thread::sleep_for(std::chrono::microseconds(us));
+        return;
+    }
+    g_chargedUs.fetch_add(us, std::memory_order_relaxed);
+}
+
+// The time already shown is kept, so the clock never steps back when the mode changes
+void host::setCpuScale(double scale) {
+    g_chargedUs.store(nowUs(), std::memory_order_relaxed);
+    g_realStart = std::chrono::steady_clock::now();
+    g_cpuScale = scale;
+}
+
+void host::setRealtime(bool realtime) {
+    uint64_t now = nowUs();
+    g_realtime = realtime;
+    g_chargedUs.store(now, std::memory_order_relaxed);
+    g_realStart = std::chrono::steady_clock::now() - std::chrono::microseconds(realtime ? now : 0);
+}
+
+unsigned long micros() { return (unsigned long)(uint32_t)host::nowUs(); }
+unsigned long millis() { return (unsigned long)(uint32_t)(host::nowUs() / 1000); }
+void delay(unsigned long ms) { host::advanceUs((uint64_t)ms * 1000); }
+void delayMicroseconds(unsigned int us) { host::advanceUs(us); }
+void yield() {}
+
+// --- Heap accounting ---
+
+namespace {
+struct AllocHeader {
+    size_t size;
+    size_t counted;
+};
+const size_t kHeaderLen = alignof(std::max_align_t); // Keeps what new returns aligned
+static_assert(sizeof(AllocHeader) <= kHeaderLen, "Header fits in front of the block");
+
+std::atomic<size_t> g_live{0};
+std::atomic<size_t> g_peak{0};
+std::atomic<uint32_t> g_allocations{0};
+thread_local int g_exemptDepth = 0;
+
+void* countedAlloc(size_t size) {
+    uint8_t* raw = (uint8_t*)malloc(kHeaderLen + size);
+    if (!raw) {
+        return nullptr;
+    }
+    AllocHeader* h = (AllocHeader*)raw;
+    h->size = size;
+    h->counted = g_exemptDepth == 0;
+    if (h->counted) {
+        size_t live = g_live.fetch_add(size) + size;
+        size_t peak = g_peak.load();
+        while (live > peak && !g_peak.compare_exchange_weak(peak, live)) {
+        }
+        g_allocations++;
+    }
+    return raw + kHeaderLen;
+}
+
+void countedFree(void* p) {
+    if (!p) {
+        return;
+    }
+    uint8_t* raw = (uint8_t*)p - kHeaderLen;
+    AllocHeader* h = (AllocHeader*)raw;
+    if (h->counted) {
+        g_live.fetch_sub(h->size);
+    }
+    free(raw);
+}
+} // namespace
+
+void* operator new(size_t size) {
+    void* p = countedAlloc(size);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+void* operator new[](size_t size) { return operator new(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return countedAlloc(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return countedAlloc(size); }
+void operator delete(void* p) noexcept { countedFree(p); }
+void operator delete[](void* p) noexcept { countedFree(p); }
+void operator delete(void* p, size_t) noexcept { countedFree(p); }
+void operator delete[](void* p, size_t) noexcept { countedFree(p); }
+
+host::HeapStats host::heap() {
+    return HeapStats{g_live.load(), g_peak.load(), g_allocations.load()};
+}
+
+void host::resetHeapPeak() { g_peak.store(g_live.load()); }
+
+host::HeapExempt::HeapExempt() { g_exemptDepth++; }
+host::HeapExempt::~HeapExempt() { g_exemptDepth--; }
+
+// --- String ---
+// Same allocation pattern as the ESP8266 core: 11 characters inline, then a heap buffer grown to
+// exactly what is asked for (rounded to 16 bytes) on every concat that does not fit.
+
+String::String(const char* text) { assign(text ? text : "", text ? strlen(text) : 0); }
+String::String(const char* text, size_t length) { assign(text, length); }
+String::String(const String& other) { assign(other.c_str(), other._len); }
+String::String(String&& other) noexcept { *this = std::move(other); }
+String::String(char c) { assign(&c, 1); }
+String::String(int value, unsigned char base) { setNumber(value < 0 ? 0ULL - (unsigned long long)value : value, base, value < 0); }
+String::String(unsigned int value, unsigned char base) { setNumber(value, base, false); }
+String::String(long value, unsigned char base) { setNumber(value < 0 ? 0ULL - (unsigned long long)value : value, base, value < 0); }
+String::String(unsigned long value, unsigned char base) { setNumber(value, base, false); }
+String::String(long long value, unsigned char base) { setNumber(value < 0 ? 0ULL - (unsigned long long)value : value, base, value < 0); }
+String::String(unsigned long long value, unsigned char base) { setNumber(value, base, false); }
+String::String(float value, unsigned char decimals) : String((double)value, decimals) {}
+String::String(double value, unsigned char decimals) {
+    char text[48];
+    snprintf(text, sizeof(text), "%.*f", decimals, value);
+    assign(text, strlen(text));
+}
+
+String::~String() { delete[] _heap; }
+
+String& String::operator=(const String& other) {
+    if (this != &other) {
+        assign(other.c_str(), other._len);
+    }
+    return *this;
+}
+
+String& String::operator=(String&& other) noexcept {
+    if (this == &other) {
+        return *this;
+    }
+    delete[] _heap;
+    _heap = other._heap;
+    _capacity = other._capacity;
+    _len = other._len;
+    memcpy(_sso, other._sso, sizeof(_sso));
+    other._heap = nullptr;
+    other._capacity = kSsoCapacity;
+    other._len = 0;
+    other._sso[0] = 0;
+    return *this;
+}
+
+String& String::operator=(const char* text) {
+    assign(text ? text : "", text ? strlen(text) : 0);
+    return *this;
+}
+
+bool String::reserve(unsigned int size) {
+    if (size <= _capacity) {
+        return true;
+    }
+    unsigned int capacity = ((size + 16) & ~0xfu) - 1;
+    char* buffer = new char[capacity + 1];
+    memcpy(buffer, _buffer(), _len + 1);
+    delete[] _heap;
+    _heap = buffer;
+    _capacity = capacity;
+    return true;
+}
+
+void String::assign(const char* text, unsigned int length) {
+    _len = 0;
+    reserve(length);
+    memmove(_buffer(), text, length);
+    _len = length;
+    _buffer()[_len] = 0;
+}
+
+bool String::concat(const char* text, unsigned int length) {
+    if (length == 0) {
+        return true;
+    }
+    const char* own = _buffer();
+    if (text >= own && text < own + _len + 1) {
+        String copy(text, length); // Appending part of itself; the buffer may move
+        return concat(copy.c_str(), length);
+    }
+    reserve(_len + length);
+    memcpy(_buffer() + _len, text, length);
+    _len += length;
+    _buffer()[_len] = 0;
+    return true;
+}
+
+void String::setNumber(unsigned long long value, unsigned char base, bool negative) {
+    char text[72];
+    int i = sizeof(text) - 1;
+    text[i] = 0;
+    if (base < 2 || base > 36) {
+        base = 10;
+    }
+    do {
+        int digit = value % base;
+        text[--i] = digit < 10 ? '0' + digit : 'a' + digit - 10;
+        value /= base;
+    } while (value);
+    if (negative) {
+        text[--i] = '-';
+    }
+    assign(text + i, sizeof(text) - 1 - i);
+}
+
+char& String::operator[](unsigned int index) {
+    static char dummy;
+    if (index >= _len) {
+        dummy = 0;
+        return dummy;
+    }
+    return _buffer()[index];
+}
+
+bool String::equalsIgnoreCase(const String& other) const {
+    return _len == other._len && strcasecmp(c_str(), other.c_str()) == 0;
+}
+
+bool String::startsWith(const String& prefix) const {
+    return prefix._len <= _len && strncmp(c_str(), prefix.c_str(), prefix._len) == 0;
+}
+
+bool String::endsWith(const String& suffix) const {
+    return suffix._len <= _len && strcmp(c_str() + _len - suffix._len, suffix.c_str()) == 0;
+}
+
+int String::indexOf(char c, unsigned int from) const {
+    if (from >= _len) {
+        return -1;
+    }
+    const char* hit = strchr(c_str() + from, c);
+    return hit ? (int)(hit - c_str()) : -1;
+}
+
+int String::indexOf(const char* text, unsigned int from) const {
+    if (from > _len) {
+        return -1;
+    }
+    const char* hit = strstr(c_str() + from, text);
+    return hit ? (int)(hit - c_str()) : -1;
+}
+
+int String::indexOf(const String& text, unsigned int from) const { return indexOf(text.c_str(), from); }
+
+int String::lastIndexOf(char c) const {
+    const char* hit = strrchr(c_str(), c);
+    return hit ? (int)(hit - c_str()) : -1;
+}
+
+String String::substring(unsigned int from, unsigned int to) const {
+    if (from > to) {
+        std::swap(from, to);
+    }
+    if (to > _len) {
+        to = _len;
+    }
+    if (from >= to) {
+        return String();
+    }
+    return String(c_str() + from, to - from);
+}
+
+void String::remove(unsigned int index, unsigned int count) {
+    if (index >= _len) {
+        return;
+    }
+    if (count > _len - index) {
+        count = _len - index;
+    }
+    char* b = _buffer();
+    memmove(b + index, b + index + count, _len - index - count + 1);
+    _len -= count;
+}
+
+void String::replace(const String& from, const String& to) {
+    if (from._len == 0) {
+        return;
+    }
+    String out;
+    unsigned int i = 0;
+    int hit;
+    while ((hit = indexOf(from, i)) >= 0) {
+        out.concat(c_str() + i, hit - i);
+        out.concat(to);
+        i = hit + from._len;
+    }
+    out.concat(c_str() + i, _len - i);
+    *this = std::move(out);
+}
+
+void String::toLowerCase() {
+    for (unsigned int i = 0; i < _len; i++) {
+        _buffer()[i] = tolower((unsigned char)_buffer()[i]);
+    }
+}
+
+void String::toUpperCase() {
+    for (unsigned int i = 0; i < _len; i++) {
+        _buffer()[i] = toupper((unsigned char)_buffer()[i]);
+    }
+}
+
+void String::trim() {
+    unsigned int begin = 0;
+    while (begin < _len && isspace((unsigned char)_buffer()[begin])) {
+        begin++;
+    }
+    unsigned int end = _len;
+    while (end > begin && isspace((unsigned char)_buffer()[end - 1])) {
+        end--;
+    }
+    String copy(c_str() + begin, end - begin);
+    *this = std::move(copy);
+}
+
+String operator+(const String& a, const String& b) {
+    String s(a);
+    s += b;
+    return s;
+}
+
+String operator+(const String& a, const char* b) {
+    String s(a);
+    s += b;
+    return s;
+}
+
+String operator+(const char* a, const String& b) {
+    String s(a);
+    s += b;
+    return s;
+}
+
+String operator+(const String& a, char b) {
+    String s(a);
+    s += b;
+    return s;
+}
+
+// --- Print / Serial ---
+
+size_t Print::write(const uint8_t* data, size_t length) {
+    size_t n = 0;
+    while (length--) {
+        n += write(*data++);
+    }
+    return n;
+}
+
+size_t Print::print(long long value, int base) { return print(String(value, (unsigned char)base)); }
+size_t Print::print(unsigned long long value, int base) { return print(String(value, (unsigned char)base)); }
+
+size_t Print::printf(const char* format, ...) {
+    char text[256];
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    if (n < 0) {
+        return 0;
+    }
+    return write((const uint8_t*)text, (size_t)n < sizeof(text) ? n : sizeof(text) - 1);
+}
+
+// Quiet unless HOST_SERIAL=1, so bench and test output stays readable
+static bool serialEnabled() {
+    static int enabled = -1;
+    if (enabled < 0) {
+        const char* env = getenv("HOST_SERIAL");
+        enabled = env && env[0] == '1';
+    }
+    return enabled;
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+    if (serialEnabled()) {
+        fputc(c, stderr);
+    }
+    return 1;
+}
+
+size_t HardwareSerial::write(const uint8_t* data, size_t length) {
+    if (serialEnabled()) {
+        fwrite(data, 1, length, stderr);
+    }
+    return length;
+}
+
+HardwareSerial Serial;
+
+String IPAddress::toString() const {
+    char text[16];
+    snprintf(text, sizeof(text), "%u.%u.%u.%u", _bytes[0], _bytes[1], _bytes[2], _bytes[3]);
+    return String(text);
+}
+
+// --- GPIO ---
+
+#define HOST_PINS 40
+
+static uint8_t g_pinLevel[HOST_PINS];
+static void (*g_isr[HOST_PINS])();
+static int g_isrMode[HOST_PINS];
+volatile uint32_t GPO = 0;
+HostGpioSetRegister GPOS;
+HostGpioClearRegister GPOC;
+
+HostGpioSetRegister& HostGpioSetRegister::operator=(uint32_t bits) {
+    GPO |= bits;
+    for (int pin = 0; pin < 16; pin++) {
+        if (bits & (1u << pin)) {
+            g_pinLevel[pin] = HIGH;
+        }
+    }
+    return *this;
+}
+
+HostGpioClearRegister& HostGpioClearRegister::operator=(uint32_t bits) {
+    GPO &= ~bits;
+    for (int pin = 0; pin < 16; pin++) {
+        if (bits & (1u << pin)) {
+            g_pinLevel[pin] = LOW;
+        }
+    }
+    return *this;
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+    if (pin < HOST_PINS && mode == INPUT_PULLUP) {
+        g_pinLevel[pin] = HIGH;
+    }
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+    if (pin >= HOST_PINS) {
+        return;
+    }
+    g_pinLevel[pin] = value ? HIGH : LOW;
+    if (pin < 16) {
+        value ? GPO |= (1u << pin) : GPO &= ~(1u << pin);
+    }
+}
+
+int digitalRead(uint8_t pin) { return pin < HOST_PINS ? g_pinLevel[pin] : LOW; }
+
+void attachInterrupt(uint8_t interrupt, void (*isr)(), int mode) {
+    if (interrupt < HOST_PINS) {
+        g_isr[interrupt] = isr;
+        g_isrMode[interrupt] = mode;
+    }
+}
+
+void detachInterrupt(uint8_t interrupt) {
+    if (interrupt < HOST_PINS) {
+        g_isr[interrupt] = nullptr;
+    }
+}
+
+int host::pinLevel(uint8_t pin) { return digitalRead(pin); }
+
+void host::drivePin(uint8_t pin, int level) {
+    if (pin >= HOST_PINS) {
+        return;
+    }
+    int old = g_pinLevel[pin];
+    g_pinLevel[pin] = level ? HIGH : LOW;
+    if (!g_isr[pin] || old == g_pinLevel[pin]) {
+        return;
+    }
+    int mode = g_isrMode[pin];
+    if (mode == CHANGE || (mode == RISING && level) || (mode == FALLING && !level)) {
+        g_isr[pin]();
+    }
+}
+
+// --- Random ---
+
+static uint32_t g_random = 0x2545F491;
+
+uint32_t hostRandom32() {
+    g_random ^= g_random << 13;
+    g_random ^= g_random >> 17;
+    g_random ^= g_random << 5;
+    return g_random;
+}
+
+void randomSeed(unsigned long seed) { g_random = seed ? (uint32_t)seed : 0x2545F491; }
+long random(long max) { return max > 0 ? (long)(hostRandom32() % (uint32_t)max) : 0; }
+long random(long min, long max) { return max > min ? min + random(max - min) : min; }
+
+// --- ESP ---
+
+static bool g_restart = false;
+
+void EspClass::restart() { g_restart = true; }
+
+uint32_t EspClass::getFreeHeap() {
+    size_t live = host::heap().live;
+    return live < HOST_HEAP_BYTES ? (uint32_t)(HOST_HEAP_BYTES - live) : 0;
+}
+
+EspClass ESP;
+
+bool host::restartRequested() { return g_restart; }
+void host::clearRestart() { g_restart = false; }
@@ -0,0 +1,237 @@
+// Arduino.h (host stand-in)
+// Just enough of the ESP8266 Arduino core to build and run the library on Linux: a heap-counting
+// String, Print/Serial, a device clock that storage models can charge time to, GPIO state and the
+// ESP object. See host_platform.h for the hooks tests use to drive and inspect it.
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <math.h>
+#include <ctype.h>
+#include <functional>
+#include <algorithm>
+
+typedef uint8_t byte;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define RISING 1
+#define FALLING 2
+#define CHANGE 3
+#define DEC 10
+#define HEX 16
+#define IRAM_ATTR
+#define ICACHE_RAM_ATTR
+#define PROGMEM
+#define PGM_P const char*
+#define PSTR(s) (s)
+#define F(s) (s)
+
+class String {
+public:
+    String(const char* text = "");
+    String(const char* text, size_t length);
+    String(const String& other);
+    String(String&& other) noexcept;
+    explicit String(char c);
+    explicit String(int value, unsigned char base = 10);
+    explicit String(unsigned int value, unsigned char base = 10);
+    explicit String(long value, unsigned char base = 10);
+    explicit String(unsigned long value, unsigned char base = 10);
+    explicit String(long long value, unsigned char base = 10);
+    explicit String(unsigned long long value, unsigned char base = 10);
+    explicit String(float value, unsigned char decimals = 2);
+    explicit String(double value, unsigned char decimals = 2);
+    ~String();
+
+    String& operator=(const String& other);
+    String& operator=(String&& other) noexcept;
+    String& operator=(const char* text);
+
+    bool reserve(unsigned int size);
+    bool concat(const char* text, unsigned int length);
+    bool concat(const char* text) { return concat(text, strlen(text)); }
+    bool concat(const String& other) { return concat(other.c_str(), other.length()); }
+    bool concat(char c) { return concat(&c, 1); }
+    String& operator+=(const String& other) { concat(other); return *this; }
+    String& operator+=(const char* text) { concat(text); return *this; }
+    String& operator+=(char c) { concat(c); return *this; }
+    String& operator+=(int value) { return *this += String(value); }
+    String& operator+=(unsigned int value) { return *this += String(value); }
+    String& operator+=(long value) { return *this += String(value); }
+    String& operator+=(unsigned long value) { return *this += String(value); }
+
+    unsigned int length() const { return _len; }
+    bool isEmpty() const { return _len == 0; }
+    const char* c_str() const { return _buffer(); }
+    char* begin() { return _buffer(); }
+    char* end() { return _buffer() + _len; }
+    char charAt(unsigned int index) const { return index < _len ? _buffer()[index] : 0; }
+    char operator[](unsigned int index) const { return charAt(index); }
+    char& operator[](unsigned int index);
+
+    bool equals(const char* text) const { return strcmp(c_str(), text) == 0; }
+    bool operator==(const String& other) const { return _len == other._len && equals(other.c_str()); }
+    bool operator==(const char* text) const { return equals(text); }
+    bool operator!=(const String& other) const { return !(*this == other); }
+    bool operator!=(const char* text) const { return !equals(text); }
+    bool equalsIgnoreCase(const String& other) const;
+    bool startsWith(const String& prefix) const;
+    bool endsWith(const String& suffix) const;
+    int indexOf(char c, unsigned int from = 0) const;
+    int indexOf(const String& text, unsigned int from = 0) const;
+    int indexOf(const char* text, unsigned int from = 0) const;
+    int lastIndexOf(char c) const;
+    String substring(unsigned int from) const { return substring(from, _len); }
+    String substring(unsigned int from, unsigned int to) const;
+    void remove(unsigned int index) { remove(index, _len > index ? _len - index : 0); }
+    void remove(unsigned int index, unsigned int count);
+    void replace(const String& from, const String& to);
+    long toInt() const { return atol(c_str()); }
+    float toFloat() const { return (float)atof(c_str()); }
+    void toLowerCase();
+    void toUpperCase();
+    void trim();
+
+private:
+    static const unsigned int kSsoCapacity = 11; // Same as the ESP8266 core's small-string buffer
+    char* _buffer() const { return _heap ? _heap : const_cast<char*>(_sso); }
+    void assign(const char* text, unsigned int length);
+    void setNumber(unsigned long long value, unsigned char base, bool negative);
+
+    char* _heap = nullptr;
+    unsigned int _capacity = kSsoCapacity;
+    unsigned int _len = 0;
+    char _sso[kSsoCapacity + 1] = {0};
+};
+
+String operator+(const String& a, const String& b);
+String operator+(const String& a, const char* b);
+String operator+(const char* a, const String& b);
+String operator+(const String& a, char b);
+
+class Print;
+class Printable {
+public:
+    virtual ~Printable() {}
+    virtual size_t printTo(Print& out) const = 0;
+};
+
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* data, size_t length);
+    size_t write(const char* text) { return write((const uint8_t*)text, strlen(text)); }
+    size_t write(const char* data, size_t length) { return write((const uint8_t*)data, length); }
+
+    size_t print(const String& s) { return write(s.c_str()); }
+    size_t print(const char* s) { return write(s); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(unsigned char value, int base = DEC) { return print((unsigned long long)value, base); }
+    size_t print(int value, int base = DEC) { return print((long long)value, base); }
+    size_t print(unsigned int value, int base = DEC) { return print((unsigned long long)value, base); }
+    size_t print(long value, int base = DEC) { return print((long long)value, base); }
+    size_t print(unsigned long value, int base = DEC) { return print((unsigned long long)value, base); }
+    size_t print(long long value, int base = DEC);
+    size_t print(unsigned long long value, int base = DEC);
+    size_t print(double value, int decimals = 2) { return print(String(value, (unsigned char)decimals)); }
+    size_t print(const Printable& p) { return p.printTo(*this); }
+
+    template <typename T>
+    size_t println(const T& value) { size_t n = print(value); return n + println(); }
+    template <typename T>
+    size_t println(const T& value, int format) { size_t n = print(value, format); return n + println(); }
+    size_t println() { return write("\r\n"); }
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+class Stream : public Print {
+public:
+    virtual int available() { return 0; }
+    virtual int read() { return -1; }
+    virtual int peek() { return -1; }
+    void setTimeout(unsigned long) {}
+};
+
+class HardwareSerial : public Stream {
+public:
+    void begin(unsigned long) {}
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* data, size_t length) override;
+    using Print::write;
+};
+extern HardwareSerial Serial;
+
+class IPAddress : public Printable {
+public:
+    IPAddress() {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) { _bytes[0] = a; _bytes[1] = b; _bytes[2] = c; _bytes[3] = d; }
+    IPAddress(uint32_t address) { memcpy(_bytes, &address, 4); } // Network byte order, as on the device
+    operator uint32_t() const { uint32_t a; memcpy(&a, _bytes, 4); return a; }
+    bool operator==(const IPAddress& other) const { return (uint32_t)*this == (uint32_t)other; }
+    uint8_t operator[](int i) const { return _bytes[i]; }
+    String toString() const;
+    size_t printTo(Print& out) const override { return out.print(toString()); }
+
+private:
+    uint8_t _bytes[4] = {0, 0, 0, 0};
+};
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+void attachInterrupt(uint8_t interrupt, void (*isr)(), int mode);
+void detachInterrupt(uint8_t interrupt);
+inline int digitalPinToInterrupt(int pin) { return pin; }
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+long random(long max);
+long random(long min, long max);
+void randomSeed(unsigned long seed);
+
+// GPIO output registers: GPOS/GPOC write through to GPO, as on the chip
+struct HostGpioSetRegister {
+    HostGpioSetRegister& operator=(uint32_t bits);
+};
+struct HostGpioClearRegister {
+    HostGpioClearRegister& operator=(uint32_t bits);
+};
+extern volatile uint32_t GPO;
+extern HostGpioSetRegister GPOS;
+extern HostGpioClearRegister GPOC;
+
+uint32_t hostRandom32();
+#define RANDOM_REG32 (hostRandom32())
+
+class EspClass {
+public:
+    void restart();
+    uint32_t getChipId() { return 0x00C0FFEE; }
+    uint32_t getFreeHeap();
+    uint32_t getMaxFreeBlockSize() { return getFreeHeap(); }
+    uint8_t getHeapFragmentation() { return 0; }
+    uint32_t getFlashChipSize() { return 4 * 1024 * 1024; }
+    uint8_t getCpuFreqMHz() { return 80; }
+    uint32_t getCycleCount() { return (uint32_t)(micros() * 80); }
+    uint32_t getFreeSketchSpace() { return 1024 * 1024; }
+    uint32_t getSketchSize() { return 512 * 1024; }
+};
+extern EspClass ESP;
+
+#endif // HOST_ARDUINO_H
@@ -0,0 +1,376 @@
+// ArduinoJson.cpp (host stand-in): lookups and the parser
+#include "ArduinoJson.h"
+
+using host_json::Slot;
+
+const Slot* host_json::member(const Slot* object, const char* key) {
+    if (!object || object->type != Slot::Object || !key) {
+        return nullptr;
+    }
+    for (const Slot* s = object->v.c.head; s; s = s->next) {
+        if (strcmp(s->key, key) == 0) {
+            return s;
+        }
+    }
+    return nullptr;
+}
+
+const Slot* host_json::element(const Slot* array, size_t index) {
+    if (!array || array->type != Slot::Array) {
+        return nullptr;
+    }
+    const Slot* s = array->v.c.head;
+    while (s && index--) {
+        s = s->next;
+    }
+    return s;
+}
+
+size_t JsonVariantConst::size() const {
+    return _slot && (_slot->type == Slot::Array || _slot->type == Slot::Object) ? _slot->v.c.size : 0;
+}
+
+const char* DeserializationError::c_str() const {
+    static const char* const kNames[] = {"Ok", "EmptyInput", "IncompleteInput", "InvalidInput", "NoMemory", "TooDeep"};
+    return kNames[_code];
+}
+
+void JsonDocument::clear() {
+    _root = Slot();
+    _used = 0;
+    _slotCount = 0;
+    _stringBytes = 0;
+}
+
+Slot* JsonDocument::allocSlot() {
+    if (_used + ARDUINOJSON_SLOT_SIZE > _capacity) {
+        return nullptr;
+    }
+    _used += ARDUINOJSON_SLOT_SIZE;
+    Slot* s = &_slots[_slotCount++];
+    *s = Slot();
+    return s;
+}
+
+char* JsonDocument::allocString(size_t length) {
+    if (_used + length + 1 > _capacity) {
+        return nullptr;
+    }
+    _used += length + 1;
+    char* s = _strings + _stringBytes;
+    _stringBytes += length + 1;
+    return s;
+}
+
+namespace {
+
+class Parser {
+public:
+    Parser(JsonDocument& doc, char* input, size_t length, bool inPlace)
+        : _doc(doc), _p(input), _end(input + length), _inPlace(inPlace) {}
+
+    DeserializationError parse() {
+        _doc.clear();
+        skipSpace();
+        if (_p == _end || *_p == 0) {
+            return DeserializationError::EmptyInput;
+        }
+        return value(*_doc.root(), ARDUINOJSON_DEFAULT_NESTING_LIMIT);
+    }
+
+private:
+    bool atEnd() const { return _p == _end || *_p == 0; }
+
+    void skipSpace() {
+        while (!atEnd() && (*_p == ' ' || *_p == '\t' || *_p == '\r' || *_p == '\n')) {
+            _p++;
+        }
+    }
+
+    DeserializationError value(Slot& out, int depth) {
+        skipSpace();
+        if (atEnd()) {
+            return DeserializationError::IncompleteInput;
+        }
+        switch (*_p) {
+        case '{': return depth > 0 ? object(out, depth - 1) : DeserializationError::TooDeep;
+        case '[': return depth > 0 ? array(out, depth - 1) : DeserializationError::TooDeep;
+        case '"':
+        case '\'': {
+            const char* s;
+            DeserializationError err = string(s);
+            if (!err) {
+                out.type = Slot::String;
+                out.v.s = s;
+            }
+            return err;
+        }
+        case 't': return literal("true", out, Slot::Bool, true);
+        case 'f': return literal("false", out, Slot::Bool, false);
+        case 'n': return literal("null", out, Slot::Null, false);
+        default: return number(out);
+        }
+    }
+
+    DeserializationError literal(const char* word, Slot& out, Slot::Type type, bool b) {
+        for (const char* w = word; *w; w++, _p++) {
+            if (atEnd()) {
+                return DeserializationError::IncompleteInput;
+            }
+            if (*_p != *w) {
+                return DeserializationError::InvalidInput;
+            }
+        }
+        out.type = type;
+        out.v.b = b;
+        return DeserializationError::Ok;
+    }
+
+    DeserializationError number(Slot& out) {
+        const char* start = _p;
+        bool negative = *_p == '-';
+        if (negative) {
+            _p++;
+        }
+        uint64_t u = 0;
+        bool overflow = false;
+        bool digits = false;
+        while (!atEnd() && *_p >= '0' && *_p <= '9') {
+            uint64_t next = u * 10 + (*_p - '0');
+            overflow = overflow || next / 10 != u;
+            u = next;
+            digits = true;
+            _p++;
+        }
+        bool isFloat = false;
+        while (!atEnd() && (*_p == '.' || *_p == 'e' || *_p == 'E' || *_p == '+' || *_p == '-' || (*_p >= '0' && *_p <= '9'))) {
+            isFloat = true;
+            _p++;
+        }
+        if (!digits) {
+            return atEnd() ? DeserializationError::IncompleteInput : DeserializationError::InvalidInput;
+        }
+        if (isFloat || overflow || (negative && u > (uint64_t)INT64_MAX + 1)) {
+            char text[64];
+            size_t n = _p - start < (long)sizeof(text) - 1 ? _p - start : sizeof(text) - 1;
+            memcpy(text, start, n);
+            text[n] = 0;
+            char* parsedEnd;
+            out.type = Slot::Float;
+            out.v.f = strtod(text, &parsedEnd);
+            return parsedEnd == text + n ? DeserializationError::Ok : DeserializationError::InvalidInput;
+        }
+        if (negative) {
+            out.type = Slot::Signed;
+            out.v.i = (int64_t)(0 - u);
+        } else {
+            out.type = Slot::Unsigned;
+            out.v.u = u;
+        }
+        return DeserializationError::Ok;
+    }
+
+    static int hexDigit(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+
+    // Unescapes into the input itself (zero-copy) or into the document's string pool
+    DeserializationError string(const char*& result) {
+        char quote = *_p++;
+        const char* scan = _p;
+        while (scan < _end && *scan && *scan != quote) {
+            scan += *scan == '\\' ? 2 : 1;
+        }
+        if (scan >= _end || *scan != quote) {
+            return DeserializationError::IncompleteInput;
+        }
+        size_t rawLength = scan - _p;
+        char* out = _inPlace ? _p : _doc.allocString(rawLength);
+        if (!out) {
+            return DeserializationError::NoMemory;
+        }
+        char* w = out;
+        while (*_p != quote) {
+            char c = *_p++;
+            if (c != '\\') {
+                *w++ = c;
+                continue;
+            }
+            c = *_p++;
+            switch (c) {
+            case 'b': *w++ = '\b'; break;
+            case 'f': *w++ = '\f'; break;
+            case 'n': *w++ = '\n'; break;
+            case 'r': *w++ = '\r'; break;
+            case 't': *w++ = '\t'; break;
+            case 'u': {
+                uint32_t cp = 0;
+                for (int i = 0; i < 4; i++) {
+                    int d = _p < scan ? hexDigit(*_p++) : -1;
+                    if (d < 0) {
+                        return DeserializationError::InvalidInput;
+                    }
+                    cp = cp << 4 | d;
+                }
+                if (cp < 0x80) {
+                    *w++ = (char)cp;
+                } else if (cp < 0x800) {
+                    *w++ = (char)(0xC0 | cp >> 6);
+                    *w++ = (char)(0x80 | (cp & 0x3F));
+                } else {
+                    *w++ = (char)(0xE0 | cp >> 12);
+                    *w++ = (char)(0x80 | ((cp >> 6) & 0x3F));
+                    *w++ = (char)(0x80 | (cp & 0x3F));
+                }
+                break;
+            }
+            default: *w++ = c; break; // \" \\ \/ and anything else as itself
+            }
+        }
+        *w = 0;
+        _p++; // Closing quote
+        result = out;
+        return DeserializationError::Ok;
+    }
+
+    DeserializationError object(Slot& out, int depth) {
+        _p++;
+        out.type = Slot::Object;
+        out.v.c.head = out.v.c.tail = nullptr;
+        out.v.c.size = 0;
+        skipSpace();
+        if (!atEnd() && *_p == '}') {
+            _p++;
+            return DeserializationError::Ok;
+        }
+        for (;;) {
+            skipSpace();
+            if (atEnd()) {
+                return DeserializationError::IncompleteInput;
+            }
+            if (*_p != '"' && *_p != '\'') {
+                return DeserializationError::InvalidInput;
+            }
+            const char* key;
+            DeserializationError err = string(key);
+            if (err) {
+                return err;
+            }
+            skipSpace();
+            if (atEnd()) {
+                return DeserializationError::IncompleteInput;
+            }
+            if (*_p++ != ':') {
+                return DeserializationError::InvalidInput;
+            }
+            // A repeated key reuses its slot, as getOrAddMember() does
+            Slot* slot = const_cast<Slot*>(host_json::member(&out, key));
+            if (!slot) {
+                slot = _doc.allocSlot();
+                if (!slot) {
+                    return DeserializationError::NoMemory;
+                }
+                slot->key = key;
+                append(out, slot);
+            }
+            err = value(*slot, depth);
+            if (err) {
+                return err;
+            }
+            skipSpace();
+            if (atEnd()) {
+                return DeserializationError::IncompleteInput;
+            }
+            char c = *_p++;
+            if (c == '}') {
+                return DeserializationError::Ok;
+            }
+            if (c != ',') {
+                return DeserializationError::InvalidInput;
+            }
+        }
+    }
+
+    DeserializationError array(Slot& out, int depth) {
+        _p++;
+        out.type = Slot::Array;
+        out.v.c.head = out.v.c.tail = nullptr;
+        out.v.c.size = 0;
+        skipSpace();
+        if (!atEnd() && *_p == ']') {
+            _p++;
+            return DeserializationError::Ok;
+        }
+        for (;;) {
+            Slot* slot = _doc.allocSlot();
+            if (!slot) {
+                return DeserializationError::NoMemory;
+            }
+            append(out, slot);
+            DeserializationError err = value(*slot, depth);
+            if (err) {
+                return err;
+            }
+            skipSpace();
+            if (atEnd()) {
+                return DeserializationError::IncompleteInput;
+            }
+            char c = *_p++;
+            if (c == ']') {
+                return DeserializationError::Ok;
+            }
+            if (c != ',') {
+                return DeserializationError::InvalidInput;
+            }
+        }
+    }
+
+    static void append(Slot& collection, Slot* slot) {
+        if (collection.v.c.tail) {
+            collection.v.c.tail->next = slot;
+        } else {
+            collection.v.c.head = slot;
+        }
+        collection.v.c.tail = slot;
+        collection.v.c.size++;
+    }
+
+    JsonDocument& _doc;
+    char* _p;
+    char* _end;
+    bool _inPlace;
+};
+
+} // namespace
+
+DeserializationError deserializeJson(JsonDocument& doc, char* input, size_t length) {
+    if (!input) {
+        doc.clear();
+        return DeserializationError::EmptyInput;
+    }
+    return Parser(doc, input, length, true).parse();
+}
+
+DeserializationError deserializeJson(JsonDocument& doc, char* input) {
+    return deserializeJson(doc, input, input ? strlen(input) : 0);
+}
+
+// The parser only writes through the input when parsing in place, so the cast is safe here
+DeserializationError deserializeJson(JsonDocument& doc, const char* input, size_t length) {
+    if (!input) {
+        doc.clear();
+        return DeserializationError::EmptyInput;
+    }
+    return Parser(doc, const_cast<char*>(input), length, false).parse();
+}
+
+DeserializationError deserializeJson(JsonDocument& doc, const char* input) {
+    return deserializeJson(doc, input, input ? strlen(input) : 0);
+}
+
+DeserializationError deserializeJson(JsonDocument& doc, const String& input) {
+    return deserializeJson(doc, input.c_str(), input.length());
+}
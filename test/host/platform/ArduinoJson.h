@@ -0,0 +1,273 @@
+// ArduinoJson.h (host stand-in)
+// The read side of ArduinoJson 6 that the library uses: StaticJsonDocument, deserializeJson
+// (zero-copy from char*, copying otherwise) and JsonVariant/JsonArray/JsonObject lookups with
+// the same conversion rules. Memory is accounted as on a 32-bit target: 16 bytes per value slot,
+// plus the string bytes when copying, so a document that is too small fails with NoMemory.
+#ifndef HOST_ARDUINOJSON_H
+#define HOST_ARDUINOJSON_H
+
+#include <Arduino.h>
+#include <limits>
+#include <type_traits>
+
+#define ARDUINOJSON_SLOT_SIZE 16
+#define ARDUINOJSON_DEFAULT_NESTING_LIMIT 10
+#define JSON_OBJECT_SIZE(n) ((n) * ARDUINOJSON_SLOT_SIZE)
+#define JSON_ARRAY_SIZE(n) ((n) * ARDUINOJSON_SLOT_SIZE)
+
+namespace host_json {
+
+struct Slot {
+    enum Type : uint8_t { Null, Bool, Signed, Unsigned, Float, String, Array, Object };
+    Type type = Null;
+    const char* key = nullptr; // Set on object members
+    Slot* next = nullptr;
+    union {
+        bool b;
+        int64_t i;
+        uint64_t u;
+        double f;
+        const char* s;
+        struct {
+            Slot* head;
+            Slot* tail;
+            size_t size;
+        } c;
+    } v;
+};
+
+const Slot* member(const Slot* object, const char* key);
+const Slot* element(const Slot* array, size_t index);
+
+template <typename T, typename Enable = void>
+struct Convert;
+
+template <typename T>
+struct Convert<T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value>::type> {
+    static bool is(const Slot* s) {
+        if (!s) {
+            return false;
+        }
+        if (s->type == Slot::Signed) {
+            return std::is_signed<T>::value ? s->v.i >= (int64_t)std::numeric_limits<T>::min() && s->v.i <= (int64_t)std::numeric_limits<T>::max()
+                                            : s->v.i >= 0 && (uint64_t)s->v.i <= (uint64_t)std::numeric_limits<T>::max();
+        }
+        if (s->type == Slot::Unsigned) {
+            return s->v.u <= (uint64_t)std::numeric_limits<T>::max();
+        }
+        return false;
+    }
+    static T as(const Slot* s) {
+        if (!s) {
+            return 0;
+        }
+        switch (s->type) {
+        case Slot::Signed:
+            return is(s) ? (T)s->v.i : 0; // Out of range reads as 0
+        case Slot::Unsigned:
+            return is(s) ? (T)s->v.u : 0;
+        case Slot::Float:
+            return s->v.f >= (double)std::numeric_limits<T>::min() && s->v.f <= (double)std::numeric_limits<T>::max() ? (T)s->v.f : 0;
+        case Slot::Bool:
+            return s->v.b;
+        default:
+            return 0;
+        }
+    }
+};
+
+template <typename T>
+struct Convert<T, typename std::enable_if<std::is_floating_point<T>::value>::type> {
+    static bool is(const Slot* s) { return s && (s->type == Slot::Float || s->type == Slot::Signed || s->type == Slot::Unsigned); }
+    static T as(const Slot* s) {
+        if (!s) {
+            return 0;
+        }
+        switch (s->type) {
+        case Slot::Float: return (T)s->v.f;
+        case Slot::Signed: return (T)s->v.i;
+        case Slot::Unsigned: return (T)s->v.u;
+        case Slot::Bool: return s->v.b;
+        default: return 0;
+        }
+    }
+};
+
+template <>
+struct Convert<bool> {
+    static bool is(const Slot* s) { return s && s->type == Slot::Bool; }
+    static bool as(const Slot* s) {
+        if (!s) {
+            return false;
+        }
+        switch (s->type) {
+        case Slot::Bool: return s->v.b;
+        case Slot::Signed: return s->v.i != 0;
+        case Slot::Unsigned: return s->v.u != 0;
+        case Slot::Float: return s->v.f != 0;
+        default: return false;
+        }
+    }
+};
+
+template <>
+struct Convert<const char*> {
+    static bool is(const Slot* s) { return s && s->type == Slot::String; }
+    static const char* as(const Slot* s) { return is(s) ? s->v.s : nullptr; }
+};
+
+template <>
+struct Convert<String> {
+    static bool is(const Slot* s) { return s && s->type == Slot::String; }
+    static String as(const Slot* s) { return is(s) ? String(s->v.s) : String(); }
+};
+
+} // namespace host_json
+
+class JsonArray;
+class JsonObject;
+
+class JsonVariantConst {
+public:
+    JsonVariantConst(const host_json::Slot* slot = nullptr) : _slot(slot) {}
+
+    template <typename T>
+    T as() const { return host_json::Convert<T>::as(_slot); }
+    template <typename T>
+    bool is() const { return host_json::Convert<T>::is(_slot); }
+    bool isNull() const { return !_slot || _slot->type == host_json::Slot::Null; }
+    size_t size() const;
+
+    template <typename T>
+    operator T() const { return as<T>(); }
+
+    // ArduinoJson's "value or default": the default when the value is missing or of another type
+    template <typename T>
+    T operator|(const T& fallback) const { return is<T>() ? as<T>() : fallback; }
+    const char* operator|(const char* fallback) const { return is<const char*>() ? as<const char*>() : fallback; }
+
+    JsonVariantConst operator[](const char* key) const { return JsonVariantConst(host_json::member(_slot, key)); }
+    JsonVariantConst operator[](int index) const { return JsonVariantConst(host_json::element(_slot, index)); }
+
+protected:
+    const host_json::Slot* _slot;
+};
+
+// Read-only, like the rest of this stand-in: the library never builds documents
+class JsonVariant : public JsonVariantConst {
+public:
+    JsonVariant(const host_json::Slot* slot = nullptr) : JsonVariantConst(slot) {}
+    using JsonVariantConst::operator|;
+    JsonVariant operator[](const char* key) const { return JsonVariant(host_json::member(_slot, key)); }
+    JsonVariant operator[](int index) const { return JsonVariant(host_json::element(_slot, index)); }
+};
+
+class JsonArray {
+public:
+    JsonArray(const host_json::Slot* slot = nullptr) : _slot(slot && slot->type == host_json::Slot::Array ? slot : nullptr) {}
+    size_t size() const { return _slot ? _slot->v.c.size : 0; }
+    bool isNull() const { return !_slot; }
+    JsonVariant operator[](size_t index) const { return JsonVariant(host_json::element(_slot, index)); }
+
+private:
+    const host_json::Slot* _slot;
+};
+
+class JsonObject {
+public:
+    JsonObject(const host_json::Slot* slot = nullptr) : _slot(slot && slot->type == host_json::Slot::Object ? slot : nullptr) {}
+    size_t size() const { return _slot ? _slot->v.c.size : 0; }
+    bool isNull() const { return !_slot; }
+    bool containsKey(const char* key) const { return host_json::member(_slot, key) != nullptr; }
+    JsonVariant operator[](const char* key) const { return JsonVariant(host_json::member(_slot, key)); }
+
+private:
+    const host_json::Slot* _slot;
+};
+
+namespace host_json {
+template <>
+struct Convert<JsonArray> {
+    static bool is(const Slot* s) { return s && s->type == Slot::Array; }
+    static JsonArray as(const Slot* s) { return JsonArray(s); }
+};
+template <>
+struct Convert<JsonObject> {
+    static bool is(const Slot* s) { return s && s->type == Slot::Object; }
+    static JsonObject as(const Slot* s) { return JsonObject(s); }
+};
+template <>
+struct Convert<JsonVariantConst> {
+    static bool is(const Slot*) { return true; }
+    static JsonVariantConst as(const Slot* s) { return JsonVariantConst(s); }
+};
+} // namespace host_json
+
+class DeserializationError {
+public:
+    enum Code { Ok, EmptyInput, IncompleteInput, InvalidInput, NoMemory, TooDeep };
+    DeserializationError(Code code = Ok) : _code(code) {}
+    explicit operator bool() const { return _code != Ok; }
+    bool operator==(Code code) const { return _code == code; }
+    bool operator!=(Code code) const { return _code != code; }
+    Code code() const { return _code; }
+    const char* c_str() const;
+
+private:
+    Code _code;
+};
+
+class JsonDocument {
+public:
+    JsonDocument(const JsonDocument&) = delete;
+    JsonDocument& operator=(const JsonDocument&) = delete;
+
+    JsonVariant operator[](const char* key) const { return JsonVariant(host_json::member(&_root, key)); }
+    JsonVariant operator[](int index) const { return JsonVariant(host_json::element(&_root, index)); }
+    template <typename T>
+    T as() const { return host_json::Convert<T>::as(&_root); }
+    template <typename T>
+    bool is() const { return host_json::Convert<T>::is(&_root); }
+    bool isNull() const { return _root.type == host_json::Slot::Null; }
+    size_t size() const { return JsonVariantConst(&_root).size(); }
+    size_t capacity() const { return _capacity; }
+    size_t memoryUsage() const { return _used; }
+    void clear();
+
+    // Parser interface
+    host_json::Slot* root() { return &_root; }
+    host_json::Slot* allocSlot();
+    char* allocString(size_t length);
+
+protected:
+    JsonDocument(host_json::Slot* slots, char* strings, size_t capacity)
+        : _slots(slots), _strings(strings), _capacity(capacity) {}
+
+private:
+    host_json::Slot _root;
+    host_json::Slot* _slots;
+    char* _strings;
+    size_t _capacity;
+    size_t _used = 0;
+    size_t _slotCount = 0;
+    size_t _stringBytes = 0;
+};
+
+template <size_t N>
+class StaticJsonDocument : public JsonDocument {
+public:
+    StaticJsonDocument() : JsonDocument(_slotStorage, _stringStorage, N) {}
+
+private:
+    host_json::Slot _slotStorage[N / ARDUINOJSON_SLOT_SIZE + 1];
+    char _stringStorage[N + 1];
+};
+
+// char* input is parsed in place (strings point into it); anything else is copied into the document
+DeserializationError deserializeJson(JsonDocument& doc, char* input, size_t length);
+DeserializationError deserializeJson(JsonDocument& doc, char* input);
+DeserializationError deserializeJson(JsonDocument& doc, const char* input, size_t length);
+DeserializationError deserializeJson(JsonDocument& doc, const char* input);
+DeserializationError deserializeJson(JsonDocument& doc, const String& input);
+
+#endif // HOST_ARDUINOJSON_H
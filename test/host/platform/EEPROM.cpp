@@ -0,0 +1,26 @@
+// EEPROM.cpp (host stand-in)
+#include "EEPROM.h"
+
+EEPROMClass EEPROM;
+
+bool EEPROMClass::begin(size_t size) {
+    if (size > sizeof(_data)) {
+        return false;
+    }
+    if (_size == 0) {
+        memset(_data, 0xFF, sizeof(_data));
+    }
+    _size = size;
+    return true;
+}
+
+void EEPROMClass::write(int address, uint8_t value) {
+    if (address >= 0 && (size_t)address < _size) {
+        _data[address] = value;
+    }
+}
+
+bool EEPROMClass::commit() {
+    _commits++;
+    return _size > 0;
+}
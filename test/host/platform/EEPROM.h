@@ -0,0 +1,41 @@
+// EEPROM.h (host stand-in)
+// The flash-emulated EEPROM: a RAM copy written back by commit().
+#ifndef HOST_EEPROM_H
+#define HOST_EEPROM_H
+
+#include <Arduino.h>
+
+class EEPROMClass {
+public:
+    bool begin(size_t size);
+    uint8_t read(int address) const { return address >= 0 && (size_t)address < _size ? _data[address] : 0; }
+    void write(int address, uint8_t value);
+    bool commit();
+    uint8_t* getDataPtr() { return _data; }
+    size_t length() const { return _size; }
+    uint32_t commits() const { return _commits; }
+
+    template <typename T>
+    T& get(int address, T& value) const {
+        if (address >= 0 && address + sizeof(T) <= _size) {
+            memcpy(&value, _data + address, sizeof(T));
+        }
+        return value;
+    }
+    template <typename T>
+    const T& put(int address, const T& value) {
+        if (address >= 0 && address + sizeof(T) <= _size) {
+            memcpy(_data + address, &value, sizeof(T));
+        }
+        return value;
+    }
+
+private:
+    uint8_t _data[4096];
+    size_t _size = 0;
+    uint32_t _commits = 0;
+};
+
+extern EEPROMClass EEPROM;
+
+#endif // HOST_EEPROM_H
@@ -0,0 +1,46 @@
+// ESP8266HTTPUpdateServer.h (host stand-in)
+// Update keeps the image it is given in memory, so a test can check what reached "flash".
+#ifndef HOST_ESP8266_HTTP_UPDATE_SERVER_H
+#define HOST_ESP8266_HTTP_UPDATE_SERVER_H
+
+#include <Arduino.h>
+#include <ESP8266WebServer.h>
+#include <vector>
+
+#define U_FLASH 0
+
+class UpdaterClass {
+public:
+    bool begin(size_t size, int command = U_FLASH);
+    size_t write(uint8_t* data, size_t length);
+    bool end(bool evenIfRemaining = false);
+    bool hasError() const { return _error != 0; }
+    void clearError() { _error = 0; }
+    void printError(Print& out) { out.printf("Update error %d\n", _error); }
+    bool isRunning() const { return _running; }
+    size_t progress() const { return _image.size(); }
+    size_t size() const { return _size; }
+    void runAsync(bool) {}
+    bool setMD5(const char*) { return true; }
+
+    // Host side: the last image end(true) accepted
+    const std::vector<uint8_t>& installed() const { return _installed; }
+
+private:
+    std::vector<uint8_t> _image;
+    std::vector<uint8_t> _installed;
+    size_t _size = 0;
+    bool _running = false;
+    int _error = 0;
+};
+
+extern UpdaterClass Update;
+
+class ESP8266HTTPUpdateServer {
+public:
+    void setup(ESP8266WebServer* server, const String& path, const String& username, const String& password) {
+        (void)server; (void)path; (void)username; (void)password;
+    }
+};
+
+#endif // HOST_ESP8266_HTTP_UPDATE_SERVER_H
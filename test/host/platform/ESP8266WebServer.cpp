@@ -0,0 +1,502 @@
+// ESP8266WebServer.cpp (host stand-in): the server core, WiFiClient and the connection model
+#include "ESP8266WebServer.h"
+#include "host_platform.h"
+
+using namespace esp8266webserver;
+
+ESP8266WiFiClass WiFi;
+
+bool ESP8266WiFiClass::softAP(const char* ssid, const char* password, int channel, int hidden, int maxConnections) {
+    (void)password; (void)channel; (void)hidden; (void)maxConnections;
+    strncpy(_ssid, ssid ? ssid : "", sizeof(_ssid) - 1);
+    _mode = WIFI_AP;
+    _softAPCalls++;
+    return ssid && ssid[0];
+}
+
+// --- Connections ---
+
+static uint64_t g_connectionCostUs = 0;
+
+void host::setConnectionCostUs(uint64_t us) { g_connectionCostUs = us; }
+
+void host::Connection::send(const std::string& raw, uint64_t arrivalUs, uint64_t tag) {
+    HeapExempt exempt;
+    pending.push_back(Request{raw, arrivalUs, tag});
+}
+
+std::string host::httpRequest(const char* method, const char* uri, const std::string& body, const char* contentType, const char* extraHeaders) {
+    HeapExempt exempt;
+    std::string raw = std::string(method) + " " + uri + " HTTP/1.1\r\nHost: 192.168.4.1\r\n";
+    if (!body.empty()) {
+        raw += std::string("Content-Type: ") + contentType + "\r\nContent-Length: " + std::to_string(body.size()) + "\r\n";
+    }
+    raw += extraHeaders;
+    raw += "\r\n";
+    raw += body;
+    return raw;
+}
+
+bool WiFiClient::connected() const {
+    if (!_connection || _connection->serverClosed) {
+        return false;
+    }
+    return !_connection->clientClosed || !_connection->pending.empty();
+}
+
+void WiFiClient::stop() {
+    if (_connection) {
+        _connection->serverClosed = true;
+    }
+}
+
+int WiFiClient::available() {
+    if (!_connection || _connection->serverClosed || !_connection->requestReady(host::nowUs())) {
+        return 0;
+    }
+    return (int)_connection->pending.front().raw.size();
+}
+
+// --- Server ---
+
+host::ConnectionPtr WebServerCore::hostConnect(IPAddress ip, uint16_t port, uint64_t atUs) {
+    host::HeapExempt exempt;
+    host::ConnectionPtr c = std::make_shared<host::Connection>();
+    c->ip = (uint32_t)ip;
+    c->port = port;
+    c->connectUs = atUs;
+    // Kept in connect order, as the listen backlog is
+    auto at = _backlog.end();
+    while (at != _backlog.begin() && (*(at - 1))->connectUs > atUs) {
+        --at;
+    }
+    _backlog.insert(at, c);
+    return c;
+}
+
+bool WebServerCore::pendingConnection() const {
+    return !_backlog.empty() && _backlog.front()->connectUs <= host::nowUs();
+}
+
+// Same states as the 3.x core: a kept-alive or silent client keeps the one slot until it
+// closes, times out, or (after a response) another connection is waiting
+void WebServerCore::handleClient() {
+    if (!_listening) {
+        return;
+    }
+    if (_currentStatus == HC_NONE) {
+        if (!pendingConnection()) {
+            return;
+        }
+        host::HeapExempt exempt;
+        host::ConnectionPtr c = _backlog.front();
+        _backlog.pop_front();
+        host::advanceUs(g_connectionCostUs);
+        c->accepted = true;
+        c->acceptedUs = host::nowUs();
+        _currentClient = WiFiClient(c);
+        _currentStatus = HC_WAIT_READ;
+        _statusChange = millis();
+    }
+
+    bool keepCurrentClient = false;
+    if (_currentClient.connected()) {
+        switch (_currentStatus) {
+        case HC_NONE:
+            break;
+        case HC_WAIT_READ:
+            if (_currentClient.available()) {
+                host::Connection& c = *_currentClient.connection();
+                std::string raw;
+                {
+                    host::HeapExempt exempt;
+                    raw.swap(c.pending.front().raw);
+                    _requestArrivalUs = c.pending.front().arrivalUs;
+                    _requestTag = c.pending.front().tag;
+                    c.pending.pop_front();
+                }
+                if (parseRequest(raw)) {
+                    handleRequest();
+                    if (_currentClient.connected()) {
+                        _currentStatus = _currentClient.available() && _keepAlive ? HC_WAIT_READ : HC_WAIT_CLOSE;
+                        _statusChange = millis();
+                        keepCurrentClient = true;
+                    }
+                }
+            } else if (millis() - _statusChange <= HTTP_MAX_DATA_WAIT) {
+                keepCurrentClient = true;
+            }
+            break;
+        case HC_WAIT_CLOSE:
+            if (!pendingConnection() && millis() - _statusChange <= HTTP_MAX_CLOSE_WAIT) {
+                keepCurrentClient = true;
+                if (_currentClient.available()) {
+                    _currentStatus = HC_WAIT_READ; // Next request on a kept-alive connection
+                }
+            }
+            break;
+        }
+    }
+    if (!keepCurrentClient) {
+        _currentClient.stop();
+        host::HeapExempt exempt;
+        _currentClient = WiFiClient();
+        _currentStatus = HC_NONE;
+        _currentUpload.reset();
+    }
+}
+
+static int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static String urlDecode(const char* text, size_t length) {
+    String out;
+    out.reserve(length);
+    for (size_t i = 0; i < length; i++) {
+        char c = text[i];
+        if (c == '+') {
+            c = ' ';
+        } else if (c == '%' && i + 2 < length && hexValue(text[i + 1]) >= 0 && hexValue(text[i + 2]) >= 0) {
+            c = (char)(hexValue(text[i + 1]) << 4 | hexValue(text[i + 2]));
+            i += 2;
+        }
+        out += c;
+    }
+    return out;
+}
+
+void WebServerCore::parseArguments(const char* data, size_t length) {
+    size_t i = 0;
+    while (i < length) {
+        size_t end = i;
+        while (end < length && data[end] != '&') {
+            end++;
+        }
+        size_t eq = i;
+        while (eq < end && data[eq] != '=') {
+            eq++;
+        }
+        if (end > i) {
+            Argument a;
+            a.key = urlDecode(data + i, eq - i);
+            a.value = eq < end ? urlDecode(data + eq + 1, end - eq - 1) : String();
+            _args.push_back(a);
+        }
+        i = end + 1;
+    }
+}
+
+static std::string headerParam(const std::string& value, const char* name) {
+    std::string key = std::string(name) + "=";
+    size_t at = value.find(key);
+    if (at == std::string::npos) {
+        return std::string();
+    }
+    at += key.size();
+    if (at < value.size() && value[at] == '"') {
+        size_t end = value.find('"', at + 1);
+        return value.substr(at + 1, end == std::string::npos ? std::string::npos : end - at - 1);
+    }
+    size_t end = value.find(';', at);
+    return value.substr(at, end == std::string::npos ? std::string::npos : end - at);
+}
+
+bool WebServerCore::parseRequest(const std::string& raw) {
+    _args.clear();
+    _headers.clear();
+    size_t lineEnd = raw.find("\r\n");
+    size_t sp1 = raw.find(' ');
+    size_t sp2 = sp1 == std::string::npos ? std::string::npos : raw.find(' ', sp1 + 1);
+    if (lineEnd == std::string::npos || sp2 == std::string::npos || sp2 > lineEnd) {
+        return false;
+    }
+    std::string method = raw.substr(0, sp1);
+    static const struct {
+        const char* name;
+        HTTPMethod method;
+    } kMethods[] = {{"GET", HTTP_GET}, {"HEAD", HTTP_HEAD}, {"POST", HTTP_POST}, {"PUT", HTTP_PUT},
+                    {"PATCH", HTTP_PATCH}, {"DELETE", HTTP_DELETE}, {"OPTIONS", HTTP_OPTIONS}};
+    _currentMethod = HTTP_ANY;
+    for (const auto& m : kMethods) {
+        if (method == m.name) {
+            _currentMethod = m.method;
+        }
+    }
+    std::string target = raw.substr(sp1 + 1, sp2 - sp1 - 1);
+    size_t query = target.find('?');
+    _currentUri = String(target.c_str(), query == std::string::npos ? target.size() : query);
+    if (query != std::string::npos) {
+        parseArguments(target.c_str() + query + 1, target.size() - query - 1);
+    }
+
+    size_t at = lineEnd + 2;
+    size_t contentLength = 0;
+    std::string contentType;
+    while (true) {
+        size_t end = raw.find("\r\n", at);
+        if (end == std::string::npos) {
+            return false;
+        }
+        if (end == at) {
+            at += 2;
+            break;
+        }
+        size_t colon = raw.find(':', at);
+        if (colon != std::string::npos && colon < end) {
+            std::string name = raw.substr(at, colon - at);
+            size_t v = colon + 1;
+            while (v < end && raw[v] == ' ') {
+                v++;
+            }
+            std::string value = raw.substr(v, end - v);
+            if (strcasecmp(name.c_str(), "Content-Length") == 0) {
+                contentLength = strtoul(value.c_str(), nullptr, 10);
+            } else if (strcasecmp(name.c_str(), "Content-Type") == 0) {
+                contentType = value;
+            }
+            bool wanted = strcasecmp(name.c_str(), "Authorization") == 0;
+            for (const String& key : _headerKeys) {
+                wanted = wanted || key.equalsIgnoreCase(String(name.c_str()));
+            }
+            if (wanted) {
+                _headers.push_back(Argument{String(name.c_str()), String(value.c_str())});
+            }
+        }
+        at = end + 2;
+    }
+    std::string body;
+    {
+        host::HeapExempt exempt; // Held by the network stack on the device, not the heap
+        body = raw.substr(at, contentLength);
+    }
+
+    // Handler first, so an upload can be streamed to it while the body is parsed
+    selectHandler();
+    if (contentType.compare(0, 19, "multipart/form-data") == 0) {
+        return parseMultipart(body, headerParam(contentType, "boundary"));
+    }
+    if (!body.empty() || _currentMethod == HTTP_POST || _currentMethod == HTTP_PUT) {
+        if (contentType.compare(0, 33, "application/x-www-form-urlencoded") == 0) {
+            parseArguments(body.data(), body.size());
+        }
+        _args.push_back(Argument{String("plain"), String(body.data(), body.size())});
+    }
+    return true;
+}
+
+bool WebServerCore::parseMultipart(const std::string& body, const std::string& boundary) {
+    if (boundary.empty()) {
+        return false;
+    }
+    std::string delimiter = "--" + boundary;
+    size_t at = body.find(delimiter);
+    while (at != std::string::npos) {
+        at += delimiter.size();
+        if (body.compare(at, 2, "--") == 0) {
+            break; // Closing delimiter
+        }
+        at += 2; // CRLF
+        size_t headersEnd = body.find("\r\n\r\n", at);
+        if (headersEnd == std::string::npos) {
+            return false;
+        }
+        std::string headers = body.substr(at, headersEnd - at);
+        size_t dataStart = headersEnd + 4;
+        size_t dataEnd = body.find("\r\n" + delimiter, dataStart);
+        if (dataEnd == std::string::npos) {
+            return false;
+        }
+        std::string name = headerParam(headers, "name");
+        std::string filename = headerParam(headers, "filename");
+        if (headers.find("filename=") == std::string::npos) {
+            _args.push_back(Argument{String(name.c_str()), String(body.data() + dataStart, dataEnd - dataStart)});
+        } else if (canUploadCurrent()) {
+            size_t typeAt = headers.find("Content-Type:");
+            std::string type = typeAt == std::string::npos ? "text/plain" : headers.substr(typeAt + 14, headers.find("\r\n", typeAt) - typeAt - 14);
+            _currentUpload.reset(new HTTPUpload());
+            HTTPUpload& up = *_currentUpload;
+            up.status = UPLOAD_FILE_START;
+            up.name = String(name.c_str());
+            up.filename = String(filename.c_str());
+            up.type = String(type.c_str());
+            up.totalSize = 0;
+            up.currentSize = 0;
+            uploadCurrent();
+            for (size_t i = dataStart; i < dataEnd;) {
+                size_t n = dataEnd - i < HTTP_UPLOAD_BUFLEN ? dataEnd - i : HTTP_UPLOAD_BUFLEN;
+                memcpy(up.buf, body.data() + i, n);
+                up.status = UPLOAD_FILE_WRITE;
+                up.currentSize = n;
+                uploadCurrent();
+                up.totalSize += n;
+                i += n;
+            }
+            up.status = UPLOAD_FILE_END;
+            up.currentSize = 0;
+            uploadCurrent();
+        }
+        at = dataEnd + 2;
+    }
+    return true;
+}
+
+void WebServerCore::handleRequest() {
+    {
+        host::HeapExempt exempt;
+        _response = host::HttpResponse();
+    }
+    _responseStarted = false;
+    _responseHeaders = String();
+    _contentLength = CONTENT_LENGTH_NOT_SET;
+    _response.arrivalUs = _requestArrivalUs;
+    _response.startedUs = host::nowUs();
+    _response.tag = _requestTag;
+
+    bool handled = handleCurrent();
+    if (!handled) {
+        if (_notFoundHandler) {
+            _notFoundHandler();
+        } else {
+            send(404, "text/plain", String("Not found: ") + _currentUri);
+        }
+    }
+    finishResponse();
+}
+
+void WebServerCore::finishResponse() {
+    host::HeapExempt exempt;
+    _response.completedUs = host::nowUs();
+    if (!_responseStarted) {
+        _response.keepAlive = _keepAlive;
+    }
+    host::Connection& c = *_currentClient.connection();
+    if (c.serverClosed) {
+        return; // Dropped by the handler; the response never leaves
+    }
+    c.responses.push_back(_response);
+    if (!_response.keepAlive) {
+        c.clientClosed = true; // "Connection: close": the client hangs up once it has the response
+    }
+    _response = host::HttpResponse();
+}
+
+void WebServerCore::sendHeader(const String& name, const String& value, bool first) {
+    String line = name + ": " + value + "\r\n";
+    _responseHeaders = first ? line + _responseHeaders : _responseHeaders + line;
+}
+
+void WebServerCore::send(int code, const char* contentType, const String& content) {
+    send(code, contentType, content.c_str(), content.length());
+}
+
+void WebServerCore::send(int code, const char* contentType, const char* content, size_t length) {
+    // The status line and headers are built in a String on the device as well
+    String head = String("HTTP/1.1 ") + String(code) + "\r\nContent-Type: " + (contentType ? contentType : "text/html") + "\r\n";
+    head += _responseHeaders;
+    head += _keepAlive ? "Connection: keep-alive\r\n" : "Connection: close\r\n";
+    host::HeapExempt exempt;
+    _response.code = code;
+    _response.contentType = contentType ? contentType : "text/html";
+    _response.headers = _responseHeaders.c_str();
+    _response.keepAlive = _keepAlive;
+    _response.body.assign(content, length);
+    _responseStarted = true;
+}
+
+void WebServerCore::sendContent(const char* content, size_t length) {
+    host::HeapExempt exempt;
+    _response.body.append(content, length);
+}
+
+const String& WebServerCore::arg(const String& name) const {
+    static const String empty;
+    for (const Argument& a : _args) {
+        if (a.key == name) {
+            return a.value;
+        }
+    }
+    return empty;
+}
+
+const String& WebServerCore::arg(int i) const {
+    static const String empty;
+    return i >= 0 && i < (int)_args.size() ? _args[i].value : empty;
+}
+
+const String& WebServerCore::argName(int i) const {
+    static const String empty;
+    return i >= 0 && i < (int)_args.size() ? _args[i].key : empty;
+}
+
+bool WebServerCore::hasArg(const String& name) const {
+    for (const Argument& a : _args) {
+        if (a.key == name) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void WebServerCore::collectHeaders(const char* headerKeys[], const size_t headerKeysCount) {
+    _headerKeys.clear();
+    for (size_t i = 0; i < headerKeysCount; i++) {
+        _headerKeys.push_back(String(headerKeys[i]));
+    }
+}
+
+const String& WebServerCore::header(const String& name) const {
+    static const String empty;
+    for (const Argument& h : _headers) {
+        if (h.key.equalsIgnoreCase(name)) {
+            return h.value;
+        }
+    }
+    return empty;
+}
+
+bool WebServerCore::hasHeader(const String& name) const {
+    for (const Argument& h : _headers) {
+        if (h.key.equalsIgnoreCase(name)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static std::string base64Decode(const char* text) {
+    static const char kAlphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    uint32_t bits = 0;
+    int count = 0;
+    for (const char* p = text; *p && *p != '='; p++) {
+        const char* hit = strchr(kAlphabet, *p);
+        if (!hit) {
+            continue;
+        }
+        bits = bits << 6 | (uint32_t)(hit - kAlphabet);
+        count += 6;
+        if (count >= 8) {
+            count -= 8;
+            out += (char)(bits >> count & 0xFF);
+        }
+    }
+    return out;
+}
+
+bool WebServerCore::authenticate(const char* user, const char* password) {
+    const String& value = header(String("Authorization"));
+    if (!value.startsWith(String("Basic "))) {
+        return false;
+    }
+    host::HeapExempt exempt;
+    return base64Decode(value.c_str() + 6) == std::string(user) + ":" + password;
+}
+
+void WebServerCore::requestAuthentication() {
+    sendHeader(String("WWW-Authenticate"), String("Basic realm=\"Login Required\""));
+    send(401, "text/html", String("401 Unauthorized"));
+}
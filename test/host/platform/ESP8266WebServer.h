@@ -0,0 +1,229 @@
+// ESP8266WebServer.h (host stand-in)
+// The ESP8266 core 3.x WebServer over host::Connection: one client at a time, the same
+// HC_WAIT_READ / HC_WAIT_CLOSE states and timeouts, RequestHandler chains, query, form and
+// "plain" arguments, and multipart uploads split into HTTP_UPLOAD_BUFLEN chunks.
+// Test clients connect with hostConnect() and read what came back from the Connection.
+#ifndef HOST_ESP8266_WEB_SERVER_H
+#define HOST_ESP8266_WEB_SERVER_H
+
+#include <Arduino.h>
+#include <ESP8266WiFi.h>
+#include <deque>
+#include <memory>
+#include <vector>
+#include "host_net.h"
+
+enum HTTPMethod { HTTP_ANY, HTTP_GET, HTTP_HEAD, HTTP_POST, HTTP_PUT, HTTP_PATCH, HTTP_DELETE, HTTP_OPTIONS };
+enum HTTPUploadStatus { UPLOAD_FILE_START, UPLOAD_FILE_WRITE, UPLOAD_FILE_END, UPLOAD_FILE_ABORTED };
+enum HTTPClientStatus { HC_NONE, HC_WAIT_READ, HC_WAIT_CLOSE };
+
+#define HTTP_UPLOAD_BUFLEN 2048
+#define HTTP_MAX_DATA_WAIT 5000  // ms to wait for the client to send the request
+#define HTTP_MAX_CLOSE_WAIT 2000 // ms to wait for the client to close the connection
+#define CONTENT_LENGTH_UNKNOWN ((size_t)-1)
+#define CONTENT_LENGTH_NOT_SET ((size_t)-2)
+
+struct HTTPUpload {
+    HTTPUploadStatus status;
+    String filename;
+    String name;
+    String type;
+    size_t totalSize;
+    size_t currentSize;
+    uint8_t buf[HTTP_UPLOAD_BUFLEN];
+};
+
+namespace esp8266webserver {
+
+template <typename ServerType>
+class ESP8266WebServerTemplate;
+
+template <typename ServerType>
+class RequestHandler {
+public:
+    using WebServerType = ESP8266WebServerTemplate<ServerType>;
+    virtual ~RequestHandler() {}
+    virtual bool canHandle(HTTPMethod method, const String& uri) { (void)method; (void)uri; return false; }
+    virtual bool canUpload(const String& uri) { (void)uri; return false; }
+    virtual bool handle(WebServerType& server, HTTPMethod requestMethod, const String& requestUri) {
+        (void)server; (void)requestMethod; (void)requestUri;
+        return false;
+    }
+    virtual void upload(WebServerType& server, const String& requestUri, HTTPUpload& upload) {
+        (void)server; (void)requestUri; (void)upload;
+    }
+    RequestHandler<ServerType>* next() { return _next; }
+    void next(RequestHandler<ServerType>* r) { _next = r; }
+
+private:
+    RequestHandler<ServerType>* _next = nullptr;
+};
+
+// Everything that does not depend on the handler type lives here (ESP8266WebServer.cpp)
+class WebServerCore {
+public:
+    typedef std::function<void(void)> THandlerFunction;
+
+    explicit WebServerCore(int port) : _port(port) {}
+    virtual ~WebServerCore() {}
+
+    void begin() { _listening = true; }
+    void close() { _listening = false; }
+    void stop() { close(); }
+    void handleClient();
+
+    const String& uri() const { return _currentUri; }
+    HTTPMethod method() const { return _currentMethod; }
+    WiFiClient& client() { return _currentClient; }
+    HTTPUpload& upload() { return *_currentUpload; }
+
+    const String& arg(const String& name) const;
+    const String& arg(int i) const;
+    const String& argName(int i) const;
+    int args() const { return (int)_args.size(); }
+    bool hasArg(const String& name) const;
+    void collectHeaders(const char* headerKeys[], const size_t headerKeysCount);
+    const String& header(const String& name) const;
+    bool hasHeader(const String& name) const;
+
+    void send(int code, const char* contentType = nullptr, const String& content = String(""));
+    void send(int code, const String& contentType, const String& content) { send(code, contentType.c_str(), content); }
+    void send(int code, const char* contentType, const char* content, size_t length);
+    void send_P(int code, PGM_P contentType, PGM_P content) { send(code, contentType, String(content)); }
+    void setContentLength(const size_t length) { _contentLength = length; }
+    void sendHeader(const String& name, const String& value, bool first = false);
+    void sendContent(const String& content) { sendContent(content.c_str(), content.length()); }
+    void sendContent(const char* content, size_t length);
+    void sendContent_P(PGM_P content) { sendContent(content, strlen(content)); }
+    void keepAlive(bool keepAlive) { _keepAlive = keepAlive; }
+    bool authenticate(const char* user, const char* password);
+    void requestAuthentication();
+    void onNotFound(THandlerFunction fn) { _notFoundHandler = fn; }
+
+    // Host side: a client connects at device time atUs and waits in the accept backlog
+    host::ConnectionPtr hostConnect(IPAddress ip, uint16_t port, uint64_t atUs);
+    size_t hostBacklog() const { return _backlog.size(); }
+    bool hostServing() const { return _currentStatus != HC_NONE; }
+
+protected:
+    // Picks the handler for the current request; the template knows the handler type
+    virtual bool selectHandler() = 0;
+    virtual bool canUploadCurrent() = 0;
+    virtual void uploadCurrent() = 0;
+    virtual bool handleCurrent() = 0;
+
+    std::unique_ptr<HTTPUpload> _currentUpload;
+
+private:
+    bool parseRequest(const std::string& raw);
+    void parseArguments(const char* data, size_t length);
+    bool parseMultipart(const std::string& body, const std::string& boundary);
+    void handleRequest();
+    void finishResponse();
+    bool pendingConnection() const;
+
+    int _port;
+    bool _listening = false;
+    std::deque<host::ConnectionPtr> _backlog;
+    WiFiClient _currentClient;
+    HTTPClientStatus _currentStatus = HC_NONE;
+    unsigned long _statusChange = 0;
+
+    HTTPMethod _currentMethod = HTTP_ANY;
+    String _currentUri;
+    struct Argument {
+        String key;
+        String value;
+    };
+    std::vector<Argument> _args;
+    std::vector<Argument> _headers;
+    std::vector<String> _headerKeys;
+
+    THandlerFunction _notFoundHandler;
+    size_t _contentLength = CONTENT_LENGTH_NOT_SET;
+    bool _keepAlive = false;
+    String _responseHeaders;
+    host::HttpResponse _response;
+    bool _responseStarted = false;
+    uint64_t _requestArrivalUs = 0;
+    uint64_t _requestTag = 0;
+};
+
+template <typename ServerType>
+class ESP8266WebServerTemplate : public WebServerCore {
+public:
+    using ClientType = WiFiClient;
+    using RequestHandlerType = RequestHandler<ServerType>;
+
+    explicit ESP8266WebServerTemplate(int port = 80) : WebServerCore(port) {}
+
+    void addHandler(RequestHandlerType* handler) {
+        if (!_lastHandler) {
+            _firstHandler = _lastHandler = handler;
+        } else {
+            _lastHandler->next(handler);
+            _lastHandler = handler;
+        }
+    }
+
+    ESP8266WebServerTemplate& on(const char* uri, THandlerFunction fn) { return on(uri, HTTP_ANY, fn); }
+    ESP8266WebServerTemplate& on(const char* uri, HTTPMethod method, THandlerFunction fn) { return on(uri, method, fn, THandlerFunction()); }
+    ESP8266WebServerTemplate& on(const char* uri, HTTPMethod method, THandlerFunction fn, THandlerFunction ufn) {
+        addHandler(new FunctionHandler(uri, method, fn, ufn));
+        return *this;
+    }
+
+protected:
+    bool selectHandler() override {
+        _currentHandler = nullptr;
+        for (RequestHandlerType* h = _firstHandler; h; h = h->next()) {
+            if (h->canHandle(method(), uri())) {
+                _currentHandler = h;
+                return true;
+            }
+        }
+        return false;
+    }
+    bool canUploadCurrent() override { return _currentHandler && _currentHandler->canUpload(uri()); }
+    void uploadCurrent() override { _currentHandler->upload(*this, uri(), *_currentUpload); }
+    bool handleCurrent() override { return _currentHandler && _currentHandler->handle(*this, method(), uri()); }
+
+private:
+    class FunctionHandler : public RequestHandlerType {
+    public:
+        FunctionHandler(const char* uri, HTTPMethod method, THandlerFunction fn, THandlerFunction ufn)
+            : _uri(uri), _method(method), _fn(fn), _ufn(ufn) {}
+        bool canHandle(HTTPMethod method, const String& uri) override {
+            return (_method == HTTP_ANY || _method == method) && uri == _uri;
+        }
+        bool canUpload(const String& uri) override { return _ufn && uri == _uri; }
+        bool handle(ESP8266WebServerTemplate&, HTTPMethod method, const String& uri) override {
+            if (!canHandle(method, uri)) {
+                return false;
+            }
+            _fn();
+            return true;
+        }
+        void upload(ESP8266WebServerTemplate&, const String& uri, HTTPUpload&) override {
+            if (canUpload(uri)) {
+                _ufn();
+            }
+        }
+
+    private:
+        String _uri;
+        HTTPMethod _method;
+        THandlerFunction _fn;
+        THandlerFunction _ufn;
+    };
+
+    RequestHandlerType* _firstHandler = nullptr;
+    RequestHandlerType* _lastHandler = nullptr;
+    RequestHandlerType* _currentHandler = nullptr;
+};
+
+} // namespace esp8266webserver
+
+using ESP8266WebServer = esp8266webserver::ESP8266WebServerTemplate<WiFiServer>;
+
+#endif // HOST_ESP8266_WEB_SERVER_H
@@ -0,0 +1,42 @@
+// ESP8266WiFi.h (host stand-in): soft-AP calls only record their arguments
+#ifndef HOST_ESP8266_WIFI_H
+#define HOST_ESP8266_WIFI_H
+
+#include <Arduino.h>
+#include <WiFiClient.h>
+
+enum WiFiMode_t { WIFI_OFF, WIFI_STA, WIFI_AP, WIFI_AP_STA };
+
+class ESP8266WiFiClass {
+public:
+    bool mode(WiFiMode_t mode) { _mode = mode; return true; }
+    bool softAP(const char* ssid, const char* password = nullptr, int channel = 1, int hidden = 0, int maxConnections = 4);
+    bool softAP(const String& ssid, const String& password) { return softAP(ssid.c_str(), password.c_str()); }
+    bool softAPConfig(IPAddress local, IPAddress gateway, IPAddress subnet) { _ip = local; (void)gateway; (void)subnet; return true; }
+    bool softAPdisconnect(bool = false) { return true; }
+    IPAddress softAPIP() const { return _ip; }
+    uint8_t softAPgetStationNum() const { return stations; }
+
+    // Host side
+    const char* ssid() const { return _ssid; }
+    uint32_t softAPCalls() const { return _softAPCalls; }
+    uint8_t stations = 1;
+
+private:
+    WiFiMode_t _mode = WIFI_OFF;
+    IPAddress _ip = IPAddress(192, 168, 4, 1);
+    char _ssid[33] = {0};
+    uint32_t _softAPCalls = 0;
+};
+
+extern ESP8266WiFiClass WiFi;
+
+class WiFiServer {
+public:
+    explicit WiFiServer(uint16_t port) : _port(port) {}
+
+private:
+    uint16_t _port;
+};
+
+#endif // HOST_ESP8266_WIFI_H
@@ -0,0 +1,16 @@
+// ESP8266mDNS.h (host stand-in): nothing is announced
+#ifndef HOST_ESP8266_MDNS_H
+#define HOST_ESP8266_MDNS_H
+
+#include <Arduino.h>
+
+class MDNSResponder {
+public:
+    bool begin(const char* hostname) { return hostname && hostname[0]; }
+    void update() {}
+    bool addService(const char*, const char*, uint16_t) { return true; }
+};
+
+extern MDNSResponder MDNS;
+
+#endif // HOST_ESP8266_MDNS_H
@@ -0,0 +1,140 @@
+// RTClib.cpp (host stand-in)
+#include "RTClib.h"
+#include "Wire.h"
+
+static const uint8_t kDaysInMonth[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30};
+
+static uint16_t daysSince2000(uint16_t y, uint8_t m, uint8_t d) {
+    if (y >= 2000) {
+        y -= 2000;
+    }
+    uint16_t days = d;
+    for (uint8_t i = 1; i < m; i++) {
+        days += kDaysInMonth[i - 1];
+    }
+    if (m > 2 && y % 4 == 0) {
+        days++;
+    }
+    return days + 365 * y + (y + 3) / 4 - 1;
+}
+
+DateTime::DateTime(uint32_t seconds) {
+    uint32_t t = seconds - SECONDS_FROM_1970_TO_2000;
+    _ss = t % 60;
+    t /= 60;
+    _mm = t % 60;
+    t /= 60;
+    _hh = t % 24;
+    uint16_t days = t / 24;
+    uint8_t leap;
+    for (_y = 0;; _y++) {
+        leap = _y % 4 == 0;
+        if (days < 365 + leap) {
+            break;
+        }
+        days -= 365 + leap;
+    }
+    for (_m = 1; _m < 12; _m++) {
+        uint8_t length = kDaysInMonth[_m - 1];
+        if (leap && _m == 2) {
+            length++;
+        }
+        if (days < length) {
+            break;
+        }
+        days -= length;
+    }
+    _d = days + 1;
+}
+
+DateTime::DateTime(uint16_t year, uint8_t month, uint8_t day, uint8_t hour, uint8_t minute, uint8_t second)
+    : _y(year >= 2000 ? year - 2000 : year), _m(month), _d(day), _hh(hour), _mm(minute), _ss(second) {}
+
+DateTime::DateTime(const char* date, const char* time) {
+    static const char kMonths[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+    _y = (uint8_t)atoi(date + 9);
+    _m = 1;
+    for (int i = 0; i < 12; i++) {
+        if (strncmp(date, kMonths + 3 * i, 3) == 0) {
+            _m = i + 1;
+        }
+    }
+    _d = (uint8_t)atoi(date + 4);
+    _hh = (uint8_t)atoi(time);
+    _mm = (uint8_t)atoi(time + 3);
+    _ss = (uint8_t)atoi(time + 6);
+}
+
+uint8_t DateTime::dayOfTheWeek() const {
+    return (daysSince2000(_y, _m, _d) + 6) % 7; // 2000-01-01 was a Saturday
+}
+
+uint32_t DateTime::unixtime() const {
+    uint32_t days = daysSince2000(_y, _m, _d);
+    return SECONDS_FROM_1970_TO_2000 + ((days * 24 + _hh) * 60 + _mm) * 60 + _ss;
+}
+
+// --- RTC_DS3231 over Wire ---
+
+#define DS3231_ADDRESS 0x68
+#define DS3231_CONTROL 0x0E
+#define DS3231_STATUS 0x0F
+
+static uint8_t bcd2bin(uint8_t v) { return v - 6 * (v >> 4); }
+static uint8_t bin2bcd(uint8_t v) { return v + 6 * (v / 10); }
+
+static uint8_t readRegister(uint8_t reg) {
+    Wire.beginTransmission(DS3231_ADDRESS);
+    Wire.write(reg);
+    Wire.endTransmission();
+    Wire.requestFrom(DS3231_ADDRESS, 1);
+    return Wire.read();
+}
+
+static void writeRegister(uint8_t reg, uint8_t value) {
+    Wire.beginTransmission(DS3231_ADDRESS);
+    Wire.write(reg);
+    Wire.write(value);
+    Wire.endTransmission();
+}
+
+bool RTC_DS3231::begin() {
+    Wire.beginTransmission(DS3231_ADDRESS);
+    return Wire.endTransmission() == 0;
+}
+
+bool RTC_DS3231::lostPower() { return readRegister(DS3231_STATUS) >> 7; }
+
+DateTime RTC_DS3231::now() {
+    Wire.beginTransmission(DS3231_ADDRESS);
+    Wire.write((uint8_t)0);
+    Wire.endTransmission();
+    Wire.requestFrom(DS3231_ADDRESS, 7);
+    uint8_t ss = bcd2bin(Wire.read() & 0x7F);
+    uint8_t mm = bcd2bin(Wire.read());
+    uint8_t hh = bcd2bin(Wire.read());
+    Wire.read();
+    uint8_t d = bcd2bin(Wire.read());
+    uint8_t m = bcd2bin(Wire.read());
+    uint16_t y = bcd2bin(Wire.read()) + 2000;
+    return DateTime(y, m, d, hh, mm, ss);
+}
+
+void RTC_DS3231::adjust(const DateTime& dt) {
+    Wire.beginTransmission(DS3231_ADDRESS);
+    Wire.write((uint8_t)0);
+    Wire.write(bin2bcd(dt.second()));
+    Wire.write(bin2bcd(dt.minute()));
+    Wire.write(bin2bcd(dt.hour()));
+    Wire.write(bin2bcd(dt.dayOfTheWeek() ? dt.dayOfTheWeek() : 7));
+    Wire.write(bin2bcd(dt.day()));
+    Wire.write(bin2bcd(dt.month()));
+    Wire.write(bin2bcd(dt.year() - 2000));
+    Wire.endTransmission();
+    writeRegister(DS3231_STATUS, readRegister(DS3231_STATUS) & ~0x80);
+}
+
+void RTC_DS3231::writeSqwPinMode(Ds3231SqwPinMode mode) {
+    uint8_t control = readRegister(DS3231_CONTROL) & ~0x1C;
+    writeRegister(DS3231_CONTROL, control | mode);
+}
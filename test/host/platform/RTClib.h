@@ -0,0 +1,62 @@
+// RTClib.h (host stand-in)
+// DateTime and RTC_DS3231 as in Adafruit RTClib; the DS3231 is read and set over the Wire model.
+#ifndef HOST_RTCLIB_H
+#define HOST_RTCLIB_H
+
+#include <Arduino.h>
+
+#define SECONDS_FROM_1970_TO_2000 946684800
+
+class TimeSpan {
+public:
+    TimeSpan(int32_t seconds = 0) : _seconds(seconds) {}
+    TimeSpan(int16_t days, int8_t hours, int8_t minutes, int8_t seconds)
+        : _seconds((int32_t)days * 86400L + (int32_t)hours * 3600 + (int32_t)minutes * 60 + seconds) {}
+    int32_t totalseconds() const { return _seconds; }
+
+private:
+    int32_t _seconds;
+};
+
+class DateTime {
+public:
+    DateTime(uint32_t seconds = SECONDS_FROM_1970_TO_2000);
+    DateTime(uint16_t year, uint8_t month, uint8_t day, uint8_t hour = 0, uint8_t minute = 0, uint8_t second = 0);
+    // __DATE__ / __TIME__ format: "Mmm dd yyyy", "hh:mm:ss"
+    DateTime(const char* date, const char* time);
+
+    uint16_t year() const { return 2000 + _y; }
+    uint8_t month() const { return _m; }
+    uint8_t day() const { return _d; }
+    uint8_t hour() const { return _hh; }
+    uint8_t minute() const { return _mm; }
+    uint8_t second() const { return _ss; }
+    uint8_t dayOfTheWeek() const; // 0 = Sunday
+    uint32_t unixtime() const;
+    uint32_t secondstime() const { return unixtime() - SECONDS_FROM_1970_TO_2000; }
+    DateTime operator+(const TimeSpan& span) const { return DateTime(unixtime() + span.totalseconds()); }
+    DateTime operator-(const TimeSpan& span) const { return DateTime(unixtime() - span.totalseconds()); }
+    bool operator==(const DateTime& other) const { return unixtime() == other.unixtime(); }
+
+private:
+    uint8_t _y, _m, _d, _hh, _mm, _ss; // Years since 2000
+};
+
+enum Ds3231SqwPinMode {
+    DS3231_OFF = 0x1C,
+    DS3231_SquareWave1Hz = 0x00,
+    DS3231_SquareWave1kHz = 0x08,
+    DS3231_SquareWave4kHz = 0x10,
+    DS3231_SquareWave8kHz = 0x18,
+};
+
+class RTC_DS3231 {
+public:
+    bool begin();
+    bool lostPower();
+    DateTime now();
+    void adjust(const DateTime& dt);
+    void writeSqwPinMode(Ds3231SqwPinMode mode);
+};
+
+#endif // HOST_RTCLIB_H
@@ -0,0 +1,51 @@
+// Update.cpp (host stand-in): Update, MDNS
+#include "ESP8266HTTPUpdateServer.h"
+#include "ESP8266mDNS.h"
+#include "host_platform.h"
+
+UpdaterClass Update;
+MDNSResponder MDNS;
+
+#define UPDATE_ERROR_SIZE 4
+#define UPDATE_ERROR_SPACE 5
+#define UPDATE_ERROR_ABORT 6
+
+bool UpdaterClass::begin(size_t size, int command) {
+    (void)command;
+    host::HeapExempt exempt;
+    if (_running || size == 0 || size > ESP.getFreeSketchSpace()) {
+        _error = UPDATE_ERROR_SPACE;
+        return false;
+    }
+    _image.clear();
+    _size = size;
+    _running = true;
+    _error = 0;
+    return true;
+}
+
+size_t UpdaterClass::write(uint8_t* data, size_t length) {
+    if (!_running || _image.size() + length > _size) {
+        _error = UPDATE_ERROR_SIZE;
+        return 0;
+    }
+    host::HeapExempt exempt;
+    _image.insert(_image.end(), data, data + length);
+    return length;
+}
+
+bool UpdaterClass::end(bool evenIfRemaining) {
+    if (!_running) {
+        return false;
+    }
+    _running = false;
+    host::HeapExempt exempt;
+    if (_image.size() != _size) {
+        _error = evenIfRemaining ? UPDATE_ERROR_ABORT : UPDATE_ERROR_SIZE;
+        _image.clear();
+        return false;
+    }
+    _installed.swap(_image);
+    _image.clear();
+    return true;
+}
@@ -0,0 +1,35 @@
+// WiFiClient.h (host stand-in): a handle on a host::Connection
+#ifndef HOST_WIFI_CLIENT_H
+#define HOST_WIFI_CLIENT_H
+
+#include <Arduino.h>
+#include "host_net.h"
+
+class WiFiClient : public Stream {
+public:
+    WiFiClient() {}
+    explicit WiFiClient(const host::ConnectionPtr& connection) : _connection(connection) {}
+
+    // Still open, or closed by the client with a request left to read
+    bool connected() const;
+    void stop();
+    IPAddress remoteIP() const { return IPAddress(_connection ? _connection->ip : 0); }
+    uint16_t remotePort() const { return _connection ? _connection->port : 0; }
+    int available() override;
+    int read() override { return -1; } // Requests are taken whole by the server
+    size_t write(uint8_t) override { return 1; }
+    size_t write(const uint8_t*, size_t length) override { return length; }
+    using Print::write;
+    void setNoDelay(bool) {}
+    void keepAlive(uint16_t = 7200, uint16_t = 75, uint8_t = 9) {}
+    void disableKeepAlive() {}
+    explicit operator bool() const { return (bool)_connection; }
+    bool operator==(const WiFiClient& other) const { return _connection == other._connection; }
+
+    const host::ConnectionPtr& connection() const { return _connection; }
+
+private:
+    host::ConnectionPtr _connection;
+};
+
+#endif // HOST_WIFI_CLIENT_H
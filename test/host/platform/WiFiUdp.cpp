@@ -0,0 +1,98 @@
+// WiFiUdp.cpp (host stand-in)
+#include "WiFiUdp.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+uint8_t WiFiUDP::begin(uint16_t port) {
+    stop();
+    _fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (_fd < 0) {
+        return 0;
+    }
+    int on = 1;
+    setsockopt(_fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    socklen_t len = sizeof(addr);
+    if (bind(_fd, (sockaddr*)&addr, sizeof(addr)) < 0 || getsockname(_fd, (sockaddr*)&addr, &len) < 0) {
+        stop();
+        return 0;
+    }
+    fcntl(_fd, F_SETFL, fcntl(_fd, F_GETFL) | O_NONBLOCK);
+    _localPort = ntohs(addr.sin_port);
+    return 1;
+}
+
+void WiFiUDP::stop() {
+    if (_fd >= 0) {
+        close(_fd);
+    }
+    _fd = -1;
+    _localPort = 0;
+    _rxLen = _rxPos = 0;
+}
+
+int WiFiUDP::parsePacket() {
+    _rxLen = _rxPos = 0;
+    if (_fd < 0) {
+        return 0;
+    }
+    sockaddr_in from = {};
+    socklen_t len = sizeof(from);
+    ssize_t n = recvfrom(_fd, _rx, sizeof(_rx), 0, (sockaddr*)&from, &len);
+    if (n <= 0) {
+        return 0;
+    }
+    _rxLen = (int)n;
+    _remoteIP = IPAddress((uint32_t)from.sin_addr.s_addr);
+    _remotePort = ntohs(from.sin_port);
+    return _rxLen;
+}
+
+int WiFiUDP::read(uint8_t* buffer, size_t length) {
+    int n = _rxLen - _rxPos < (int)length ? _rxLen - _rxPos : (int)length;
+    memcpy(buffer, _rx + _rxPos, n);
+    _rxPos += n;
+    return n;
+}
+
+int WiFiUDP::beginPacket(IPAddress ip, uint16_t port) {
+    _txIP = ip;
+    _txPort = port;
+    _txLen = 0;
+    return 1;
+}
+
+int WiFiUDP::beginPacket(const char* host, uint16_t port) {
+    in_addr addr;
+    if (inet_pton(AF_INET, host, &addr) != 1) {
+        return 0;
+    }
+    return beginPacket(IPAddress((uint32_t)addr.s_addr), port);
+}
+
+size_t WiFiUDP::write(const uint8_t* data, size_t length) {
+    size_t n = sizeof(_tx) - _txLen < length ? sizeof(_tx) - _txLen : length;
+    memcpy(_tx + _txLen, data, n);
+    _txLen += n;
+    return n;
+}
+
+int WiFiUDP::endPacket() {
+    if (_fd < 0 && !begin(0)) {
+        return 0;
+    }
+    sockaddr_in to = {};
+    to.sin_family = AF_INET;
+    to.sin_addr.s_addr = (uint32_t)_txIP;
+    to.sin_port = htons(_txPort);
+    ssize_t n = sendto(_fd, _tx, _txLen, 0, (sockaddr*)&to, sizeof(to));
+    _txLen = 0;
+    return n >= 0;
+}
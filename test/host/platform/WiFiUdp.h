@@ -0,0 +1,47 @@
+// WiFiUdp.h (host stand-in): a non-blocking POSIX UDP socket
+#ifndef HOST_WIFI_UDP_H
+#define HOST_WIFI_UDP_H
+
+#include <Arduino.h>
+
+#define HOST_UDP_MAX_PACKET 1472
+
+class WiFiUDP : public Stream {
+public:
+    ~WiFiUDP() { stop(); }
+    // Binds 0.0.0.0:port (0 = any free port, see localPort()); 1 on success
+    uint8_t begin(uint16_t port);
+    void stop();
+    uint16_t localPort() const { return _localPort; }
+
+    int parsePacket();
+    int available() override { return _rxLen - _rxPos; }
+    int read() override { return _rxPos < _rxLen ? _rx[_rxPos++] : -1; }
+    int read(uint8_t* buffer, size_t length);
+    int read(char* buffer, size_t length) { return read((uint8_t*)buffer, length); }
+    int peek() override { return _rxPos < _rxLen ? _rx[_rxPos] : -1; }
+    IPAddress remoteIP() const { return _remoteIP; }
+    uint16_t remotePort() const { return _remotePort; }
+
+    int beginPacket(IPAddress ip, uint16_t port);
+    int beginPacket(const char* host, uint16_t port);
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t* data, size_t length) override;
+    using Print::write;
+    int endPacket();
+
+private:
+    int _fd = -1;
+    uint16_t _localPort = 0;
+    uint8_t _rx[HOST_UDP_MAX_PACKET];
+    int _rxLen = 0;
+    int _rxPos = 0;
+    IPAddress _remoteIP;
+    uint16_t _remotePort = 0;
+    uint8_t _tx[HOST_UDP_MAX_PACKET];
+    size_t _txLen = 0;
+    IPAddress _txIP;
+    uint16_t _txPort = 0;
+};
+
+#endif // HOST_WIFI_UDP_H
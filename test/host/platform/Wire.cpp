@@ -0,0 +1,217 @@
+// Wire.cpp (host stand-in): the bus and the devices on it
+#include "Wire.h"
+#include "RTClib.h"
+
+#include <vector>
+
+TwoWire Wire;
+
+namespace {
+
+// --- 24C256 (or a larger part of the same family, with block-select bits in its address) ---
+struct EepromModel {
+    std::vector<uint8_t> data;
+    uint32_t pointer = 0;
+    uint64_t busyUntilUs = 0;
+    uint32_t writeCycleUs = 5000; // tWR, worst case from the datasheet
+    int failAfter = -1;
+    host::I2cStats stats = {};
+
+    EepromModel() {
+        host::HeapExempt exempt;
+        data.assign(HOST_EEPROM_BYTES, 0xFF);
+    }
+    bool answers(uint8_t address) const {
+        return address >= HOST_EEPROM_BASE && address <= HOST_EEPROM_BASE + ((HOST_EEPROM_BYTES - 1) >> 16);
+    }
+    bool busy() const { return host::nowUs() < busyUntilUs; }
+};
+
+EepromModel& eeprom() {
+    static EepromModel model;
+    return model;
+}
+
+// --- DS3231: time registers in BCD, kept from a base time and the device clock ---
+struct RtcModel {
+    uint32_t baseUnix = 1767225600; // 2026-01-01 00:00:00
+    uint64_t baseUs = 0;
+    uint8_t pointer = 0;
+    uint8_t control = 0x1C;
+    uint8_t status = 0x80; // OSF: oscillator stopped, so the firmware sets the time on first boot
+
+    uint32_t seconds() const { return baseUnix + (uint32_t)((host::nowUs() - baseUs) / 1000000); }
+    void setUnix(uint32_t t) {
+        baseUnix = t;
+        baseUs = host::nowUs();
+    }
+};
+
+RtcModel& rtc() {
+    static RtcModel model;
+    return model;
+}
+
+uint8_t toBcd(uint8_t v) { return (uint8_t)((v / 10) << 4 | (v % 10)); }
+uint8_t fromBcd(uint8_t v) { return (uint8_t)((v >> 4) * 10 + (v & 0x0F)); }
+
+uint8_t rtcRegister(uint8_t reg) {
+    DateTime now(rtc().seconds());
+    switch (reg) {
+    case 0x00: return toBcd(now.second());
+    case 0x01: return toBcd(now.minute());
+    case 0x02: return toBcd(now.hour());
+    case 0x03: return (uint8_t)(now.dayOfTheWeek() + 1);
+    case 0x04: return toBcd(now.day());
+    case 0x05: return toBcd(now.month());
+    case 0x06: return toBcd((uint8_t)(now.year() - 2000));
+    case 0x0E: return rtc().control;
+    case 0x0F: return rtc().status;
+    default: return 0;
+    }
+}
+
+void rtcWrite(const uint8_t* data, size_t length) {
+    RtcModel& r = rtc();
+    r.pointer = data[0];
+    if (length >= 8 && r.pointer == 0x00) {
+        DateTime t(2000 + fromBcd(data[7]), fromBcd(data[6] & 0x1F), fromBcd(data[5]),
+                   fromBcd(data[3] & 0x3F), fromBcd(data[2]), fromBcd(data[1] & 0x7F));
+        r.setUnix(t.unixtime());
+        return;
+    }
+    for (size_t i = 1; i < length; i++, r.pointer++) {
+        if (r.pointer == 0x0E) {
+            r.control = data[i];
+        } else if (r.pointer == 0x0F) {
+            r.status = data[i];
+        }
+    }
+}
+
+} // namespace
+
+void TwoWire::chargeBus(size_t bytes, bool isEeprom) {
+    uint64_t us = ((uint64_t)11 + 9 * (uint64_t)bytes) * 1000000ULL / _clockHz;
+    host::advanceUs(us);
+    if (isEeprom) {
+        eeprom().stats.transactions++;
+        eeprom().stats.busUs += us;
+    }
+}
+
+void TwoWire::beginTransmission(uint8_t address) {
+    _txAddress = address;
+    _txLen = 0;
+}
+
+size_t TwoWire::write(uint8_t c) {
+    if (_txLen >= sizeof(_tx)) {
+        return 0;
+    }
+    _tx[_txLen++] = c;
+    return 1;
+}
+
+size_t TwoWire::write(const uint8_t* data, size_t length) {
+    size_t n = 0;
+    while (n < length && write(data[n])) {
+        n++;
+    }
+    return n;
+}
+
+uint8_t TwoWire::endTransmission(bool stop) {
+    EepromModel& e = eeprom();
+    if (e.answers(_txAddress)) {
+        if (e.busy()) {
+            chargeBus(0, true); // Address NACKed: the payload never goes out
+            e.stats.nackPolls++;
+            return 2;
+        }
+        chargeBus(_txLen, true);
+        e.stats.bytesWritten += _txLen;
+        if (_txLen < 2) {
+            return 0; // ACK poll
+        }
+        uint32_t block = (uint32_t)(_txAddress - HOST_EEPROM_BASE) << 16;
+        e.pointer = (block | (uint32_t)_tx[0] << 8 | _tx[1]) % HOST_EEPROM_BYTES;
+        if (_txLen == 2) {
+            return 0; // Random read: sets the pointer
+        }
+        if (e.failAfter == 0) {
+            return 3;
+        }
+        if (e.failAfter > 0) {
+            e.failAfter--;
+        }
+        // Page write: the address counter wraps inside the page
+        uint32_t page = e.pointer - e.pointer % HOST_EEPROM_PAGE;
+        uint32_t offset = e.pointer % HOST_EEPROM_PAGE;
+        for (size_t i = 2; i < _txLen; i++) {
+            e.data[page + offset] = _tx[i];
+            offset = (offset + 1) % HOST_EEPROM_PAGE;
+        }
+        e.pointer = page + offset;
+        if (stop) {
+            e.busyUntilUs = host::nowUs() + e.writeCycleUs;
+            e.stats.writeCycles++;
+            e.stats.writeCycleUs += e.writeCycleUs;
+        }
+        return 0;
+    }
+    chargeBus(_txAddress == HOST_RTC_ADDR ? _txLen : 0, false);
+    if (_txAddress == HOST_RTC_ADDR) {
+        if (_txLen > 0) {
+            rtcWrite(_tx, _txLen);
+        }
+        return 0;
+    }
+    return 2;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, size_t count, bool stop) {
+    (void)stop;
+    _rxLen = 0;
+    _rxPos = 0;
+    if (count > sizeof(_rx)) {
+        count = sizeof(_rx);
+    }
+    EepromModel& e = eeprom();
+    if (e.answers(address)) {
+        if (e.busy()) {
+            chargeBus(0, true);
+            e.stats.nackPolls++;
+            return 0;
+        }
+        chargeBus(count, true);
+        e.stats.bytesRead += count;
+        for (size_t i = 0; i < count; i++) {
+            _rx[i] = e.data[e.pointer];
+            e.pointer = (e.pointer + 1) % HOST_EEPROM_BYTES; // Sequential reads roll over the whole array
+        }
+        _rxLen = count;
+        return (uint8_t)count;
+    }
+    if (address == HOST_RTC_ADDR) {
+        chargeBus(count, false);
+        for (size_t i = 0; i < count; i++) {
+            _rx[i] = rtcRegister(rtc().pointer++);
+        }
+        _rxLen = count;
+        return (uint8_t)count;
+    }
+    chargeBus(0, false);
+    return 0;
+}
+
+host::I2cStats host::i2cStats() { return eeprom().stats; }
+void host::resetI2cStats() { eeprom().stats = I2cStats(); }
+std::vector<uint8_t>& host::eepromImage() { return eeprom().data; }
+void host::setEepromWriteCycleUs(uint32_t us) { eeprom().writeCycleUs = us; }
+void host::failEepromWritesAfter(int after) { eeprom().failAfter = after; }
+
+void host::setRtcUnix(uint32_t seconds) {
+    rtc().setUnix(seconds);
+    rtc().status &= ~0x80;
+}
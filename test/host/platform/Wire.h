@@ -0,0 +1,47 @@
+// Wire.h (host stand-in)
+// TwoWire on a modeled bus: a 24C256-style EEPROM and a DS3231 answer on it, and every
+// transaction is charged to the device clock. See host_platform.h for the cost model.
+#ifndef HOST_WIRE_H
+#define HOST_WIRE_H
+
+#include <Arduino.h>
+#include "host_platform.h"
+
+#define BUFFER_LENGTH HOST_WIRE_BUFFER
+
+class TwoWire : public Stream {
+public:
+    void begin() {}
+    void begin(int sda, int scl) { (void)sda; (void)scl; }
+    void setClock(uint32_t hz) { _clockHz = hz ? hz : 100000; }
+
+    void beginTransmission(uint8_t address);
+    void beginTransmission(int address) { beginTransmission((uint8_t)address); }
+    // 0 = ACK, 2 = address NACK (absent or busy device), 3 = data NACK
+    uint8_t endTransmission(bool stop = true);
+    uint8_t requestFrom(uint8_t address, size_t count, bool stop = true);
+    uint8_t requestFrom(int address, int count) { return requestFrom((uint8_t)address, (size_t)count); }
+
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* data, size_t length) override;
+    size_t write(int c) { return write((uint8_t)c); }
+    using Print::write;
+    int available() override { return _rxLen - _rxPos; }
+    int read() override { return _rxPos < _rxLen ? _rx[_rxPos++] : -1; }
+    int peek() override { return _rxPos < _rxLen ? _rx[_rxPos] : -1; }
+
+private:
+    void chargeBus(size_t bytes, bool eeprom);
+
+    uint32_t _clockHz = 100000; // Wire default, as I2C_BUS_HZ in SC_Bench.h
+    uint8_t _txAddress = 0;
+    uint8_t _tx[BUFFER_LENGTH];
+    size_t _txLen = 0;
+    uint8_t _rx[BUFFER_LENGTH];
+    size_t _rxLen = 0;
+    size_t _rxPos = 0;
+};
+
+extern TwoWire Wire;
+
+#endif // HOST_WIRE_H
@@ -0,0 +1,63 @@
+// host_net.h
+// The socket stand-in behind WiFiClient and the WebServer: a Connection carries whole HTTP
+// requests from a test client, each stamped with the device time it arrives at, and collects
+// the responses with the device time each one was completed. Nothing here is on the device
+// heap; the server's own parsing is, as on the device.
+#ifndef HOST_NET_H
+#define HOST_NET_H
+
+#include <stdint.h>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace host {
+
+struct HttpResponse {
+    int code = 0;          // 0 = the handler returned without sending anything
+    std::string contentType;
+    std::string headers;   // As sent with sendHeader(), "Name: value\r\n" each
+    std::string body;
+    bool keepAlive = false;
+    uint64_t arrivalUs = 0;   // When the request reached the device
+    uint64_t startedUs = 0;   // When the server started handling it
+    uint64_t completedUs = 0; // When the handler returned
+    uint64_t tag = 0;         // Copied from the request, for the test's bookkeeping
+};
+
+struct Connection {
+    uint32_t ip = 0;       // Network byte order, as IPAddress
+    uint16_t port = 0;
+    uint64_t connectUs = 0;
+    uint64_t acceptedUs = 0;
+    bool accepted = false;
+    bool clientClosed = false; // FIN from the client; requests already sent can still be read
+    bool serverClosed = false;
+
+    struct Request {
+        std::string raw;
+        uint64_t arrivalUs;
+        uint64_t tag;
+    };
+    std::deque<Request> pending;
+    std::vector<HttpResponse> responses;
+
+    void send(const std::string& raw, uint64_t arrivalUs, uint64_t tag = 0);
+    bool requestReady(uint64_t nowUs) const { return !pending.empty() && pending.front().arrivalUs <= nowUs; }
+    bool open() const { return !serverClosed && !clientClosed; }
+};
+
+typedef std::shared_ptr<Connection> ConnectionPtr;
+
+// Device time charged when the server accepts a connection: the handshake, PCB setup and later
+// teardown in lwIP, which the stand-in does not run. 0 by default.
+void setConnectionCostUs(uint64_t us);
+
+// A complete HTTP/1.1 request; the body is sent with Content-Length
+std::string httpRequest(const char* method, const char* uri, const std::string& body = std::string(),
+                        const char* contentType = "application/json", const char* extraHeaders = "");
+
+} // namespace host
+
+#endif // HOST_NET_H
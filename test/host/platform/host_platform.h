@@ -0,0 +1,82 @@
+// host_platform.h
+// Hooks the host tests and benches use to drive the stand-in platform: the device clock, heap
+// accounting, GPIO/interrupt injection and the I2C bus model (24C256 EEPROM + DS3231).
+#ifndef HOST_PLATFORM_H
+#define HOST_PLATFORM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+#ifndef HOST_HEAP_BYTES
+#define HOST_HEAP_BYTES 49152 // Roughly what an ESP8266 has free once the AP is up
+#endif
+
+#ifndef HOST_EEPROM_BYTES
+#define HOST_EEPROM_BYTES 32768 // 24C256
+#endif
+#define HOST_EEPROM_PAGE 64       // 24C256 write page
+#define HOST_EEPROM_BASE 0x50     // A0..A2 low; larger parts answer on 0x50..0x57 (block select)
+#define HOST_RTC_ADDR 0x68        // DS3231
+#define HOST_WIRE_BUFFER 128      // ESP8266/ESP32 Wire buffer
+
+namespace host {
+
+// --- Device clock ---
+// micros() is the time charged by the models (bus transfers, write cycles, delay()) plus the
+// real time the host spent, multiplied by cpuScale. With cpuScale 0 runs are deterministic.
+// In realtime mode the clock is the real clock and charged time is slept instead.
+uint64_t nowUs();
+void advanceUs(uint64_t us);
+void setCpuScale(double scale);
+void setRealtime(bool realtime);
+
+// --- Heap ---
+// Every operator new is counted against HOST_HEAP_BYTES unless a HeapExempt is in scope, which
+// platform code uses for its own bookkeeping so only what the firmware allocates shows up.
+struct HeapStats {
+    size_t live;        // Bytes currently allocated
+    size_t peak;        // High-water mark since resetHeapPeak()
+    uint32_t allocations;
+};
+HeapStats heap();
+void resetHeapPeak();
+class HeapExempt {
+public:
+    HeapExempt();
+    ~HeapExempt();
+};
+
+// --- GPIO ---
+int pinLevel(uint8_t pin);
+// Drives an input pin; an interrupt attached to it fires on a matching edge
+void drivePin(uint8_t pin, int level);
+
+// --- ESP.restart() only records the request ---
+bool restartRequested();
+void clearRestart();
+
+// --- I2C bus model ---
+// Each transaction costs START + address byte + STOP (11 clocks) plus 9 clocks per byte at the
+// Wire clock. A write ended by STOP starts an internal write cycle of eepromWriteCycleUs, during
+// which the EEPROM NACKs its address. Counters are kept for the EEPROM only.
+struct I2cStats {
+    uint32_t transactions;
+    uint32_t bytesRead;
+    uint32_t bytesWritten;
+    uint32_t writeCycles;
+    uint32_t nackPolls;     // Transactions refused while a write cycle was running
+    uint64_t busUs;         // Time charged for bus transfers
+    uint64_t writeCycleUs;  // Time charged for write cycles (polled or waited)
+};
+I2cStats i2cStats();
+void resetI2cStats();
+std::vector<uint8_t>& eepromImage(); // HOST_EEPROM_BYTES, erased to 0xFF
+void setEepromWriteCycleUs(uint32_t us);
+// Every write transaction after the next `after` ones fails (NACK on the data), for fault tests
+void failEepromWritesAfter(int after);
+void setRtcUnix(uint32_t seconds);
+
+} // namespace host
+
+#endif // HOST_PLATFORM_H
@@ -0,0 +1,206 @@
+// test_access_core.cpp
+// SpscRing and RcuCell under two real threads, and TagSnapshot::decide() against schedules.
+#include "SC_AccessCore.h"
+#include "SC_Rcu.h"
+#include "host_test.h"
+
+#include <atomic>
+#include <thread>
+
+namespace {
+
+TagId tag(uint32_t n) {
+    char digits[16];
+    snprintf(digits, sizeof(digits), "%lu", (unsigned long)n);
+    TagId t;
+    TagId::parse(digits, t);
+    return t;
+}
+
+// Every item arrives once and in order, with the producer retrying while the ring is full
+void ringInOrder() {
+    static SpscRing<uint64_t, 16> ring;
+    const uint64_t items = 500000;
+    std::thread producer([&] {
+        for (uint64_t i = 1; i <= items; i++) {
+            while (!ring.push(i)) {
+                std::this_thread::yield();
+            }
+        }
+    });
+    uint64_t expected = 1, bad = 0, item;
+    while (expected <= items) {
+        if (ring.pop(item)) {
+            bad += item != expected;
+            expected++;
+        } else {
+            std::this_thread::yield(); // Hands the core over when the host has only one
+        }
+    }
+    producer.join();
+    CHECK_EQ(bad, 0);
+    CHECK(!ring.pop(item));
+    CHECK_EQ(ring.size(), 0);
+}
+
+// An ISR does not retry: what is dropped is counted, and what gets through is still in order
+void ringDropping() {
+    static SpscRing<uint32_t, 8> ring;
+    const uint32_t items = 1000000;
+    std::atomic<bool> done{false};
+    std::thread producer([&] {
+        for (uint32_t i = 1; i <= items; i++) {
+            ring.push(i);
+        }
+        done.store(true);
+    });
+    uint32_t last = 0, received = 0, bad = 0, item;
+    while (!done.load() || ring.size() > 0) {
+        if (ring.pop(item)) {
+            bad += item <= last;
+            last = item;
+            received++;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+    CHECK_EQ(bad, 0);
+    CHECK_EQ(received + ring.dropped(), items);
+}
+
+struct Payload {
+    uint32_t generation;
+    uint32_t words[255];
+};
+
+// The reader never sees a copy the writer is filling: every word matches the generation, and
+// generations never go backwards
+void rcuNoTornReads() {
+    static RcuCell<Payload> cell;
+    const uint32_t generations = 50000;
+    std::atomic<bool> done{false};
+    std::thread writer([&] {
+        for (uint32_t g = 1; g <= generations; g++) {
+            Payload& p = cell.writeBegin();
+            p.generation = g;
+            for (uint32_t& w : p.words) {
+                w = g;
+            }
+            cell.publish();
+        }
+        done.store(true);
+    });
+    uint32_t last = 0, torn = 0, backwards = 0, reads = 0;
+    while (!done.load()) {
+        const Payload& p = cell.readLock();
+        uint32_t g = p.generation;
+        for (uint32_t w : p.words) {
+            torn += w != g;
+        }
+        cell.readUnlock();
+        backwards += g < last;
+        last = g;
+        reads++;
+    }
+    writer.join();
+    CHECK_EQ(torn, 0);
+    CHECK_EQ(backwards, 0);
+    CHECK(reads > 0);
+    const Payload& p = cell.readLock();
+    CHECK_EQ(p.generation, generations);
+    cell.readUnlock();
+}
+
+// The snapshot the access task reads: decisions stay consistent while the network core
+// republishes the tag store
+void rcuSnapshots() {
+    static RcuCell<TagSnapshot> cell;
+    const uint32_t generations = 10000;
+    std::atomic<bool> done{false};
+    std::thread writer([&] {
+        for (uint32_t g = 1; g <= generations; g++) {
+            TagSnapshot& s = cell.writeBegin();
+            // Generation g holds tags g..g+9, all on schedule 0
+            s.count = 10;
+            for (int i = 0; i < 10; i++) {
+                s.tags[i] = tag(g + i);
+                s.tagSchedule[i] = 0;
+            }
+            s.schedules[0].fill();
+            cell.publish();
+        }
+        done.store(true);
+    });
+    uint32_t wrong = 0;
+    while (!done.load()) {
+        const TagSnapshot& s = cell.readLock();
+        if (s.count == 0) { // Nothing published yet
+            cell.readUnlock();
+            continue;
+        }
+        TagId first = s.tags[0];
+        uint32_t g = 0;
+        for (int i = 0; i < TAG_ID_LEN; i++) {
+            g = g * 10 + (first.digits[i] - '0');
+        }
+        wrong += s.decide(tag(g + 9), 0) != ACCESS_GRANTED;
+        wrong += s.decide(tag(g + 10), 0) != ACCESS_DENIED;
+        cell.readUnlock();
+    }
+    writer.join();
+    CHECK_EQ(wrong, 0);
+}
+
+void decide() {
+    static TagSnapshot s;
+    s.count = 4;
+    s.tags[0] = tag(100); // Any time
+    s.tags[1] = tag(101); // Schedule 1: Monday-Friday 08:00-17:30
+    s.tags[2] = tag(102); // Schedule 2: every day 22:00-06:00
+    s.tags[3] = tag(103); // Schedule id out of range: treated as any time
+    s.tags[4] = tag(104); // Past count: not in the store
+    const uint8_t ids[] = {0, 1, 2, SCHEDULE_COUNT + 1, 0};
+    memcpy(s.tagSchedule, ids, sizeof(ids));
+    for (WeeklySchedule& w : s.schedules) {
+        w.clear();
+    }
+    s.schedules[0].fill();
+    s.schedules[1].addWindow(0x3E, 8 * 60, 17 * 60 + 30);
+    s.schedules[2].addWindow(0x7F, 22 * 60, 6 * 60);
+
+    const uint32_t monday = 1767571200;    // 2026-01-05 00:00 UTC, a Monday
+    const uint32_t saturday = monday + 5 * 86400;
+    CHECK_EQ(scheduleSlot(monday), SCHEDULE_SLOTS_PER_DAY);
+
+    CHECK_EQ(s.decide(tag(100), 0), ACCESS_GRANTED); // No clock needed for schedule 0
+    CHECK_EQ(s.decide(tag(100), saturday), ACCESS_GRANTED);
+    CHECK_EQ(s.decide(tag(999), monday + 9 * 3600), ACCESS_DENIED);
+    CHECK_EQ(s.decide(tag(104), monday + 9 * 3600), ACCESS_DENIED);
+    CHECK_EQ(s.decide(tag(103), 0), ACCESS_GRANTED);
+
+    CHECK_EQ(s.decide(tag(101), monday + 8 * 3600), ACCESS_GRANTED);
+    CHECK_EQ(s.decide(tag(101), monday + 8 * 3600 - 1), ACCESS_DENIED);
+    CHECK_EQ(s.decide(tag(101), monday + 17 * 3600 + 29 * 60), ACCESS_GRANTED);
+    CHECK_EQ(s.decide(tag(101), monday + 17 * 3600 + 30 * 60), ACCESS_DENIED);
+    CHECK_EQ(s.decide(tag(101), saturday + 9 * 3600), ACCESS_DENIED);
+    CHECK_EQ(s.decide(tag(101), 0), ACCESS_DENIED); // A scheduled tag needs the clock
+
+    // Past midnight, into the next day and from Saturday into Sunday
+    CHECK_EQ(s.decide(tag(102), monday + 23 * 3600), ACCESS_GRANTED);
+    CHECK_EQ(s.decide(tag(102), monday + 86400 + 5 * 3600 + 59 * 60), ACCESS_GRANTED);
+    CHECK_EQ(s.decide(tag(102), monday + 86400 + 6 * 3600), ACCESS_DENIED);
+    CHECK_EQ(s.decide(tag(102), saturday + 86400 + 3600), ACCESS_GRANTED);
+    CHECK_EQ(s.decide(tag(102), monday + 12 * 3600), ACCESS_DENIED);
+}
+
+} // namespace
+
+int main() {
+    ringInOrder();
+    ringDropping();
+    rcuNoTornReads();
+    rcuSnapshots();
+    decide();
+    return TEST_RESULT("test_access_core");
+}
@@ -0,0 +1,210 @@
+// test_access_udp.cpp
+// The binary reader protocol over real UDP sockets on the loopback interface: the boot nonce
+// and CHALLENGE op, per-reader replay windows, a frame recorded before a reboot, a second reader
+// right after a grant, and the round trip time a reader sees. The device runs in realtime mode, so the modeled bus time of the tag
+// lookup is slept rather than only counted.
+#include "host_device.h"
+#include "host_test.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+namespace {
+
+const uint8_t kKey[ACCESS_KEY_LEN] = {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+                                      0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f};
+
+// A reader: its own socket, so the device sees it as a separate peer
+class Reader {
+public:
+    Reader() {
+        _fd = socket(AF_INET, SOCK_DGRAM, 0);
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        bind(_fd, (sockaddr*)&addr, sizeof(addr));
+        fcntl(_fd, F_SETFL, fcntl(_fd, F_GETFL) | O_NONBLOCK);
+    }
+    ~Reader() { close(_fd); }
+
+    void send(const uint8_t* frame, size_t len, uint16_t port) {
+        sockaddr_in to = {};
+        to.sin_family = AF_INET;
+        to.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        to.sin_port = htons(port);
+        sendto(_fd, frame, len, 0, (sockaddr*)&to, sizeof(to));
+    }
+
+    // Runs the device loop until a response arrives or timeoutUs of real time has passed
+    bool receive(UserManagementClass& device, AccessResponse& response, uint64_t timeoutUs = 200000) {
+        auto start = std::chrono::steady_clock::now();
+        for (;;) {
+            uint8_t buf[64];
+            ssize_t n = recv(_fd, buf, sizeof(buf), 0);
+            if (n > 0) {
+                return AccessProtocol::decodeResponse(kKey, buf, (size_t)n, response);
+            }
+            if (std::chrono::steady_clock::now() - start > std::chrono::microseconds(timeoutUs)) {
+                return false;
+            }
+            device.handleAccessUdp();
+        }
+    }
+
+    AccessResponse exchange(UserManagementClass& device, uint16_t port, uint8_t op, uint16_t reader,
+                            uint32_t nonce, uint32_t seq, const char* tag) {
+        uint8_t frame[ACCESS_REQUEST_LEN];
+        AccessProtocol::encodeRequest(kKey, op, reader, nonce, seq, tag, frame);
+        send(frame, sizeof(frame), port);
+        AccessResponse response = {};
+        response.status = 0xFF; // No answer
+        receive(device, response);
+        return response;
+    }
+
+private:
+    int _fd;
+};
+
+uint16_t startListener(UserManagementClass& device, uint16_t port) {
+    CHECK(device.beginAccessUdp(kKey, port));
+    return port;
+}
+
+void protocol(uint16_t port) {
+    Reader reader, other;
+    // A reader that has not asked yet is told the nonce
+    AccessResponse r = reader.exchange(users, port, ACCESS_OP_CHECK_TAG, 3, 0, 1, "1000000000");
+    CHECK_EQ(r.status, ACCESS_STALE_NONCE);
+    CHECK_EQ(r.reader, 3);
+    CHECK_EQ(r.seq, 1);
+    uint32_t nonce = r.nonce;
+    r = reader.exchange(users, port, ACCESS_OP_CHALLENGE, 3, 0, 2, "");
+    CHECK_EQ(r.status, ACCESS_NONCE);
+    CHECK_EQ(r.op, ACCESS_OP_CHALLENGE);
+    CHECK_EQ(r.nonce, nonce);
+
+    // The stale answers did not open reader 3's window: seq 1 is still fresh
+    CHECK_EQ(reader.exchange(users, port, ACCESS_OP_CHECK_TAG, 3, nonce, 1, "1000000000").status, ACCESS_GRANTED);
+    CHECK_EQ(reader.exchange(users, port, ACCESS_OP_CHECK_TAG, 3, nonce, 1, "1000000000").status, ACCESS_REPLAYED);
+    CHECK_EQ(reader.exchange(users, port, ACCESS_OP_CHECK_TAG, 3, nonce, 2, "1000000001").status, ACCESS_GRANTED);
+    CHECK_EQ(reader.exchange(users, port, ACCESS_OP_CHECK_TAG, 3, nonce, 3, "999").status, ACCESS_DENIED);
+    // The window is the reader id's, not the source address's
+    CHECK_EQ(other.exchange(users, port, ACCESS_OP_CHECK_TAG, 3, nonce, 3, "1000000000").status, ACCESS_REPLAYED);
+    CHECK_EQ(other.exchange(users, port, ACCESS_OP_CHECK_TAG, 4, nonce, 1, "1000000000").status, ACCESS_GRANTED);
+    CHECK_EQ(reader.exchange(users, port, ACCESS_OP_CHECK_TAG, 3, nonce, 4, "1000000000").status, ACCESS_GRANTED);
+    // Every id keeps its slot, whatever the others do
+    for (uint16_t id = 0; id < ACCESS_MAX_READERS; id++) {
+        other.exchange(users, port, ACCESS_OP_CHECK_TAG, id, nonce, 1000, "1000000000");
+    }
+    CHECK_EQ(reader.exchange(users, port, ACCESS_OP_CHECK_TAG, 3, nonce, 4, "1000000000").status, ACCESS_REPLAYED);
+    CHECK_EQ(reader.exchange(users, port, ACCESS_OP_CHECK_TAG, ACCESS_MAX_READERS, nonce, 1, "1000000000").status,
+             ACCESS_BAD_REQUEST);
+    CHECK_EQ(reader.exchange(users, port, 0x7E, 5, nonce, 1001, "1000000000").status, ACCESS_BAD_REQUEST);
+
+    // A frame under another key, or altered in flight, gets no answer at all
+    uint8_t frame[ACCESS_REQUEST_LEN];
+    AccessProtocol::encodeRequest(kKey, ACCESS_OP_CHECK_TAG, 6, nonce, 1, "1000000000", frame);
+    frame[14] ^= 1;
+    reader.send(frame, sizeof(frame), port);
+    AccessResponse none;
+    CHECK(!reader.receive(users, none, 50000));
+}
+
+// The controller reboots: its windows start empty, but a frame recorded before the reboot
+// carries the old nonce and is turned away
+void replayAcrossReboot(uint16_t port) {
+    Reader reader;
+    uint32_t nonce = reader.exchange(users, port, ACCESS_OP_CHALLENGE, 7, 0, 0, "").nonce;
+    uint8_t recorded[ACCESS_REQUEST_LEN];
+    AccessProtocol::encodeRequest(kKey, ACCESS_OP_CHECK_TAG, 7, nonce, 1001, "1000000000", recorded);
+    reader.send(recorded, sizeof(recorded), port);
+    AccessResponse r;
+    CHECK(reader.receive(users, r));
+    CHECK_EQ(r.status, ACCESS_GRANTED);
+
+    UserManagementClass rebooted(server, RELAY_PIN); // Same key and storage, new boot
+    uint16_t rebootedPort = startListener(rebooted, ACCESS_UDP_PORT + 1);
+    reader.send(recorded, sizeof(recorded), rebootedPort);
+    CHECK(reader.receive(rebooted, r));
+    CHECK_EQ(r.status, ACCESS_STALE_NONCE);
+    CHECK(r.nonce != nonce);
+    // The reader carries on with the new nonce; its window starts over
+    CHECK_EQ(reader.exchange(rebooted, rebootedPort, ACCESS_OP_CHECK_TAG, 7, r.nonce, 1002, "").status, ACCESS_BAD_REQUEST);
+    CHECK_EQ(reader.exchange(rebooted, rebootedPort, ACCESS_OP_CHECK_TAG, 7, r.nonce, 1002, "").status, ACCESS_REPLAYED);
+}
+
+// A grant starts the door pulse and returns: the next reader is answered at once, and the relay
+// is switched off by the loop once ACCESS_PULSE_MS is up
+void grantThenSecondReader(uint16_t port) {
+    Reader door, second;
+    uint32_t nonce = door.exchange(users, port, ACCESS_OP_CHALLENGE, 11, 0, 0, "").nonce;
+    auto start = std::chrono::steady_clock::now();
+    CHECK_EQ(door.exchange(users, port, ACCESS_OP_USE_TAG, 11, nonce, 1001, "1000000005").status, ACCESS_GRANTED);
+    auto granted = std::chrono::steady_clock::now();
+    CHECK_EQ(digitalRead(RELAY_PIN), HIGH);
+    CHECK_EQ(second.exchange(users, port, ACCESS_OP_CHECK_TAG, 12, nonce, 1001, "1000000006").status, ACCESS_GRANTED);
+    auto answered = std::chrono::steady_clock::now();
+    double grantMs = std::chrono::duration<double, std::milli>(granted - start).count();
+    double secondMs = std::chrono::duration<double, std::milli>(answered - granted).count();
+    printf("use_tag grant %.1f ms, then another reader's check_tag %.1f ms (pulse %d ms)\n", grantMs, secondMs,
+           ACCESS_PULSE_MS);
+    CHECK(grantMs < 100);
+    CHECK(secondMs < 100);
+
+    while (std::chrono::steady_clock::now() - start < std::chrono::milliseconds(ACCESS_PULSE_MS - 500)) {
+        users.handleClient();
+    }
+    CHECK_EQ(digitalRead(RELAY_PIN), HIGH);
+    while (std::chrono::steady_clock::now() - start < std::chrono::milliseconds(ACCESS_PULSE_MS + 500)) {
+        users.handleClient();
+    }
+    CHECK_EQ(digitalRead(RELAY_PIN), LOW);
+}
+
+void latency(uint16_t port, uint8_t op, const char* name, int rounds) {
+    Reader reader;
+    uint32_t nonce = reader.exchange(users, port, ACCESS_OP_CHALLENGE, 9, 0, 0, "").nonce;
+    std::vector<double> us;
+    static uint32_t seq = 10000; // Past what protocol() left in the windows
+    for (int i = 0; i < rounds; i++) {
+        uint8_t frame[ACCESS_REQUEST_LEN];
+        AccessProtocol::encodeRequest(kKey, op, 9, nonce, seq++, "1000000000", frame);
+        auto start = std::chrono::steady_clock::now();
+        reader.send(frame, sizeof(frame), port);
+        AccessResponse r;
+        bool answered = reader.receive(users, r);
+        us.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+        CHECK(answered && (r.status == ACCESS_GRANTED || r.status == ACCESS_NONCE));
+    }
+    std::sort(us.begin(), us.end());
+    printf("  %-22s %5d rounds  p50 %8.1f us  p99 %8.1f us  max %8.1f us\n", name, rounds, us[us.size() / 2],
+           us[us.size() * 99 / 100], us.back());
+}
+
+} // namespace
+
+int main() {
+    host::bootDevice();
+    CHECK_EQ(host::exchange("POST", "/api/users/delete_all_tags").code, 200);
+    for (int i = 0; i < 20; i++) {
+        CHECK(users.storeTag(String(1000000000 + i).c_str()));
+    }
+    uint16_t port = startListener(users, ACCESS_UDP_PORT);
+    host::setRealtime(true);
+
+    protocol(port);
+    replayAcrossReboot(port);
+    grantThenSecondReader(port);
+    printf("loopback round trip, 20 tags on the modeled 24C256 (bus time slept):\n");
+    latency(port, ACCESS_OP_CHALLENGE, "challenge (no lookup)", 2000);
+    latency(port, ACCESS_OP_CHECK_TAG, "check_tag (first tag)", 500);
+    return TEST_RESULT("test_access_udp");
+}
@@ -0,0 +1,143 @@
+// test_lanes.cpp
+// Request lanes under load: door-reader calls mixed with admin exports and tag writes stay
+// answered within a bound, heavy routes are admission-limited, and a client that connects and
+// says nothing is dropped at HTTP_READ_DEADLINE_MS instead of holding the server for the core's
+// HTTP_MAX_DATA_WAIT. Half the access calls are for stored tags, so grants and their door pulses
+// are part of the mix. Device time is the modeled cost alone (cpu scale 0), so runs repeat.
+#include "host_load.h"
+#include "host_test.h"
+
+namespace {
+
+// The server cannot preempt a request it has started. At 200 tags a miss costs ~230 ms, so an
+// access call can wait for one admitted export or tag write (up to ~860 ms) and for the access
+// calls that arrived just before it. Without admission, exports would queue up in front as well.
+const double kAccessP99BoundMs = 1500;
+
+void mixedLoad() {
+    host::LoadConfig alone;
+    alone.rate = 1.2;
+    alone.seconds = 120;
+    alone.mix[host::LOAD_ADD_TAG] = 0;
+    alone.mix[host::LOAD_GET_TAGS] = 0;
+    host::LoadReport baseline = host::runLoad(alone);
+    printf("access alone      1.2 req/s: p50 %7.1f ms  p99 %7.1f ms  max %7.1f ms\n",
+           baseline.access.percentileMs(0.5), baseline.access.percentileMs(0.99), baseline.access.maxMs());
+
+    uint32_t rejected = 0;
+    for (uint32_t seed = 1; seed <= 5; seed++) {
+        host::LoadConfig mixed;
+        mixed.rate = 2;
+        mixed.seconds = 120;
+        mixed.mix[host::LOAD_USE_TAG] = 30;
+        mixed.mix[host::LOAD_CHECK_TAG] = 30;
+        mixed.mix[host::LOAD_ADD_TAG] = 10;
+        mixed.mix[host::LOAD_GET_TAGS] = 30;
+        mixed.hit = 0.5;
+        mixed.seed = seed;
+        uint32_t actuations = scMetrics.relayActuations;
+        host::LoadReport r = host::runLoad(mixed);
+        actuations = scMetrics.relayActuations - actuations;
+        const host::LoadRouteStats& access = r.access;
+        printf("mixed, seed %u    2.0 req/s: p50 %7.1f ms  p99 %7.1f ms  max %7.1f ms  (%u access, %u relay switches, "
+               "%u get_tags, %u refused)\n",
+               seed, access.percentileMs(0.5), access.percentileMs(0.99), access.maxMs(), access.sent, actuations,
+               r.routes[host::LOAD_GET_TAGS].sent, r.routes[host::LOAD_GET_TAGS].rejected);
+        CHECK(access.sent > 0);
+        CHECK(actuations > 0); // Grants pulsed the door without holding up the calls behind them
+        CHECK_EQ(access.ok, access.sent); // Access calls are never refused or dropped
+        CHECK(access.percentileMs(0.99) < kAccessP99BoundMs);
+        CHECK_EQ(r.routes[host::LOAD_ADD_TAG].ok, r.routes[host::LOAD_ADD_TAG].sent);
+        rejected += r.routes[host::LOAD_GET_TAGS].rejected;
+    }
+    CHECK(rejected > 0);
+}
+
+// A grant is answered at once and the relay is switched off by handleClient() at the deadline
+void accessPulse() {
+    host::advanceUs(10000000);
+    uint64_t start = host::nowUs();
+    host::HttpResponse granted = host::exchange("POST", "/api/users/use_tag", "{\"tag\":\"1000000007\"}");
+    CHECK(granted.body.find("\"found\":true") != std::string::npos);
+    CHECK(host::nowUs() - start < ACCESS_PULSE_MS * 1000ULL / 10);
+    CHECK(host::exchange("GET", "/api/relay/get_state").body.find("\"state\":\"on\"") != std::string::npos);
+    while (host::nowUs() < start + ACCESS_PULSE_MS * 1000ULL + 100000) {
+        host::loopOnce(10000);
+    }
+    CHECK(host::exchange("GET", "/api/relay/get_state").body.find("\"state\":\"off\"") != std::string::npos);
+}
+
+void heavyAdmission() {
+    host::advanceUs(10000000); // A full bucket
+    CHECK_EQ(host::exchange("GET", "/metrics").code, 200);
+    CHECK_EQ(host::exchange("GET", "/metrics").code, 200);
+    host::HttpResponse refused = host::exchange("GET", "/metrics");
+    CHECK_EQ(refused.code, 503);
+    CHECK(refused.headers.find("Retry-After: ") != std::string::npos);
+    host::advanceUs(HEAVY_ADMIT_INTERVAL_MS * 1000ULL);
+    CHECK_EQ(host::exchange("GET", "/metrics").code, 200);
+
+    // Right after an access call the bucket is not drawn on
+    host::advanceUs(10000000);
+    CHECK_EQ(host::exchange("POST", "/api/users/check_tag", "{\"tag\":\"5000000000\"}").code, 200);
+    CHECK_EQ(host::exchange("GET", "/metrics").code, 503);
+    host::advanceUs(ACCESS_LANE_HOLD_MS * 1000ULL);
+    CHECK_EQ(host::exchange("GET", "/metrics").code, 200);
+}
+
+void stalledClient() {
+    host::advanceUs(10000000);
+    uint64_t start = host::nowUs();
+    host::ConnectionPtr silent = server.hostConnect(IPAddress(192, 168, 4, 30), 43000, start);
+    host::ConnectionPtr reader = server.hostConnect(IPAddress(192, 168, 4, 10), 43001, start + 10000);
+    reader->send(host::httpRequest("POST", "/api/users/use_tag", "{\"tag\":\"5000000000\"}"), start + 10000);
+    while (reader->responses.empty() && host::nowUs() < start + 30000000) {
+        host::loopOnce();
+    }
+    CHECK_EQ(reader->responses.size(), 1);
+    CHECK(silent->serverClosed);
+    if (!reader->responses.empty()) {
+        double waitedMs = (reader->responses[0].completedUs - (start + 10000)) / 1000.0;
+        printf("use_tag behind a silent client: %.1f ms (read deadline %d ms, core wait %d ms)\n", waitedMs,
+               HTTP_READ_DEADLINE_MS, HTTP_MAX_DATA_WAIT);
+        CHECK(waitedMs < HTTP_READ_DEADLINE_MS + 500);
+    }
+    reader->clientClosed = true;
+    while (server.hostServing()) {
+        host::loopOnce();
+    }
+}
+
+// A connection served by a handler outside the route tables, then idle, is not a stalled client
+void idleAfterUntabledRequest() {
+    static const char* const kUris[] = {"/no_such_page", "/update"};
+    for (const char* uri : kUris) {
+        host::advanceUs(10000000);
+        uint32_t drops = scMetrics.readDeadlineDrops;
+        uint64_t start = host::nowUs();
+        host::ConnectionPtr c = server.hostConnect(IPAddress(192, 168, 4, 20), 43100, start);
+        c->send(host::httpRequest("GET", uri), start);
+        while (host::nowUs() < start + (HTTP_READ_DEADLINE_MS + 1000) * 1000ULL) {
+            host::loopOnce(10000);
+        }
+        CHECK_EQ(c->responses.size(), 1);
+        CHECK_EQ(scMetrics.readDeadlineDrops, drops);
+        c->clientClosed = true;
+        while (server.hostServing()) {
+            host::loopOnce();
+        }
+    }
+}
+
+} // namespace
+
+int main() {
+    host::setCpuScale(0);
+    host::bootDevice();
+    mixedLoad();
+    accessPulse();
+    heavyAdmission();
+    stalledClient();
+    idleAfterUntabledRequest();
+    return TEST_RESULT("test_lanes");
+}
@@ -0,0 +1,266 @@
+// test_ota_stream.cpp
+// Sha256 against the FIPS 180-2 vectors, OtaStream classification, hold-back and resume on a
+// memory sink, then a resumed upload through /api/ota/{begin,chunk,status,finish}.
+#include "host_device.h"
+#include "host_test.h"
+
+#include <string>
+#include <vector>
+
+namespace {
+
+std::string hex(const uint8_t* data, size_t len) {
+    static const char digits[] = "0123456789abcdef";
+    std::string out;
+    for (size_t i = 0; i < len; i++) {
+        out += digits[data[i] >> 4];
+        out += digits[data[i] & 15];
+    }
+    return out;
+}
+
+std::string sha256Hex(const std::string& message, size_t chunk) {
+    Sha256 sha;
+    for (size_t at = 0; at < message.size(); at += chunk) {
+        size_t n = message.size() - at < chunk ? message.size() - at : chunk;
+        sha.update((const uint8_t*)message.data() + at, n);
+    }
+    uint8_t out[OTA_SHA256_LEN];
+    sha.digest(out);
+    return hex(out, sizeof(out));
+}
+
+void shaVectors() {
+    struct Vector {
+        std::string message;
+        const char* digest;
+    };
+    const Vector vectors[] = {
+        {"", "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855"},
+        {"abc", "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"},
+        {"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+         "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1"},
+        {"abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmnhijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu",
+         "cf5b16a778af8380036ce59e7b0492370b249b11e8f07a51afac45037afee9d1"},
+        {std::string(55, 'a'), "9f4390f8d30c2dd92ec9f095b65e2b9ae9b0a925a5258e241c9f1e910f734318"}, // Padding fits the block
+        {std::string(56, 'a'), "b35439a4ac6f0948b6d6f9e3c6af0f5f590ce20f1bde7090ef7970686ec6738a"}, // Padding needs another
+        {std::string(64, 'a'), "ffe054fe7ae0cb6dc65c3af9b61d5209f439851db43d0ba5997337df154668eb"},
+        {std::string(1000000, 'a'), "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0"},
+    };
+    const size_t chunks[] = {1, 3, 63, 64, 65, 1000000};
+    for (const Vector& v : vectors) {
+        for (size_t chunk : chunks) {
+            CHECK_STR(sha256Hex(v.message, chunk), v.digest);
+        }
+    }
+    // digest() finalises a copy: the running hash carries on
+    Sha256 sha;
+    sha.update((const uint8_t*)"ab", 2);
+    uint8_t peek[OTA_SHA256_LEN];
+    sha.digest(peek);
+    sha.update((const uint8_t*)"c", 1);
+    sha.digest(peek);
+    CHECK_STR(hex(peek, sizeof(peek)), vectors[1].digest);
+}
+
+class MemorySink : public OtaSink {
+public:
+    std::vector<uint8_t> data;
+    size_t capacity = (size_t)-1; // Writes past this fail, as a dropped link or a full flash would
+
+    size_t write(const uint8_t* bytes, size_t len) override {
+        size_t n = capacity - data.size() < len ? capacity - data.size() : len;
+        data.insert(data.end(), bytes, bytes + n);
+        return n;
+    }
+};
+
+std::vector<uint8_t> image(size_t size, uint8_t first, uint8_t second) {
+    std::vector<uint8_t> out(size);
+    for (size_t i = 0; i < size; i++) {
+        out[i] = (uint8_t)(i * 131 + 7);
+    }
+    out[0] = first;
+    out[1] = second;
+    return out;
+}
+
+void shaOf(const std::vector<uint8_t>& data, uint8_t out[OTA_SHA256_LEN]) {
+    Sha256 sha;
+    sha.update(data.data(), data.size());
+    sha.digest(out);
+}
+
+// Writes the image in the given chunk sizes (the last repeats) and finishes
+bool stream(OtaStream& ota, MemorySink& sink, const std::vector<uint8_t>& img, std::vector<size_t> chunks) {
+    size_t at = 0;
+    for (size_t i = 0; at < img.size(); i++) {
+        size_t n = chunks[i < chunks.size() ? i : chunks.size() - 1];
+        n = img.size() - at < n ? img.size() - at : n;
+        if (ota.write(sink, img.data() + at, n) != n) {
+            return false;
+        }
+        at += n;
+    }
+    return ota.finish(sink);
+}
+
+void classification() {
+    uint8_t sha[OTA_SHA256_LEN];
+    // The kind is decided on two bytes even when they arrive one at a time
+    const std::vector<size_t> splits[] = {{1}, {1, 4096}, {2, 4096}, {4096}, {3, 1, 7}};
+    for (const std::vector<size_t>& split : splits) {
+        std::vector<uint8_t> gz = image(5000, 0x1F, 0x8B);
+        shaOf(gz, sha);
+        OtaStream ota;
+        MemorySink sink;
+        CHECK(ota.begin(gz.size(), sha));
+        CHECK(stream(ota, sink, gz, split));
+        CHECK_EQ(ota.kind(), OTA_IMAGE_GZIP);
+        CHECK(sink.data == gz);
+    }
+    {
+        std::vector<uint8_t> raw = image(300, 0xE9, 0x03);
+        shaOf(raw, sha);
+        OtaStream ota;
+        MemorySink sink;
+        CHECK(ota.begin(raw.size(), sha));
+        CHECK_EQ(ota.write(sink, raw.data(), 1), 1);
+        CHECK_EQ(sink.data.size(), 0); // Held until the second byte
+        CHECK_EQ(ota.offset(), 1);
+        CHECK_EQ(ota.kind(), OTA_IMAGE_UNKNOWN);
+        CHECK_EQ(ota.write(sink, raw.data() + 1, 1), 1);
+        CHECK_EQ(ota.kind(), OTA_IMAGE_RAW);
+        CHECK_EQ(sink.data.size(), 2);
+        CHECK(stream(ota, sink, std::vector<uint8_t>(), {1}) == false); // Not complete yet
+    }
+    // Not an image: nothing reaches the sink, whether the head comes in one write or two
+    const uint8_t junk[][2] = {{0x1F, 0x00}, {0x00, 0x8B}, {'P', 'K'}};
+    for (const uint8_t* head : junk) {
+        std::vector<uint8_t> bad = image(100, head[0], head[1]);
+        shaOf(bad, sha);
+        OtaStream ota;
+        MemorySink sink;
+        CHECK(ota.begin(bad.size(), sha));
+        CHECK_EQ(ota.write(sink, bad.data(), bad.size()), 0);
+        CHECK_EQ(ota.write(sink, bad.data(), 1), 1);
+        CHECK_EQ(ota.write(sink, bad.data() + 1, 99), 0);
+        CHECK_EQ(ota.offset(), 0);
+        CHECK(sink.data.empty());
+    }
+    // A two-byte image is all head and held-back byte
+    std::vector<uint8_t> tiny = {0xE9, 0x00};
+    shaOf(tiny, sha);
+    OtaStream ota;
+    MemorySink sink;
+    CHECK(ota.begin(2, sha));
+    CHECK_EQ(ota.write(sink, tiny.data(), 1), 1);
+    CHECK_EQ(ota.write(sink, tiny.data() + 1, 1), 1);
+    CHECK_EQ(sink.data.size(), 1);
+    CHECK(ota.finish(sink));
+    CHECK(sink.data == tiny);
+}
+
+void holdBack() {
+    std::vector<uint8_t> raw = image(4097, 0xE9, 0x01);
+    uint8_t sha[OTA_SHA256_LEN];
+    shaOf(raw, sha);
+    sha[0] ^= 1;
+    OtaStream ota;
+    MemorySink sink;
+    CHECK(ota.begin(raw.size(), sha));
+    CHECK(!stream(ota, sink, raw, {1024}));
+    CHECK_EQ(ota.offset(), raw.size());
+    CHECK_EQ(sink.data.size(), raw.size() - 1); // The final byte never went out
+    CHECK_EQ(ota.write(sink, raw.data(), 1), 0); // Full
+}
+
+// The link drops partway: the stream keeps what the sink took, and the client resumes from offset()
+void resumeAfterTruncation() {
+    std::vector<uint8_t> gz = image(10000, 0x1F, 0x8B);
+    uint8_t sha[OTA_SHA256_LEN];
+    shaOf(gz, sha);
+    const size_t cuts[] = {0, 1, 2, 1, 777, 4096, 9998, 9999};
+    for (size_t cut : cuts) {
+        OtaStream ota;
+        MemorySink sink;
+        sink.capacity = cut;
+        CHECK(ota.begin(gz.size(), sha));
+        size_t taken = ota.write(sink, gz.data(), cut == 1 ? 1 : 4096);
+        if (cut == 1) {
+            CHECK_EQ(taken, 1); // Only the first head byte came in
+        }
+        while (taken == 4096 && ota.offset() < gz.size()) {
+            size_t n = gz.size() - ota.offset() < 4096 ? gz.size() - ota.offset() : 4096;
+            taken = ota.write(sink, gz.data() + ota.offset(), n);
+        }
+        size_t resumeAt = ota.offset();
+        CHECK_EQ(resumeAt, cut >= gz.size() - 1 ? gz.size() : cut); // The held-back byte counts once all else is in
+        CHECK(ota.resumable(gz.size(), sha));
+        sink.capacity = (size_t)-1;
+        std::vector<uint8_t> rest(gz.begin() + resumeAt, gz.end());
+        for (size_t at = 0; at < rest.size(); at += 1000) {
+            size_t n = rest.size() - at < 1000 ? rest.size() - at : 1000;
+            CHECK_EQ(ota.write(sink, rest.data() + at, n), n);
+        }
+        CHECK(ota.finish(sink));
+        CHECK(sink.data == gz);
+    }
+    // A different image is not resumed
+    OtaStream ota;
+    MemorySink sink;
+    CHECK(ota.begin(gz.size(), sha));
+    uint8_t other[OTA_SHA256_LEN];
+    memcpy(other, sha, sizeof(other));
+    other[31] ^= 0x80;
+    CHECK(!ota.resumable(gz.size(), other));
+    CHECK(!ota.resumable(gz.size() + 1, sha));
+}
+
+const char* kAuth = "Authorization: Basic YWRtaW46YWRtaW4=\r\n"; // OTA_USERNAME:OTA_PASSWORD
+
+host::HttpResponse chunk(const std::vector<uint8_t>& img, size_t offset, size_t len) {
+    std::string uri = "/api/ota/chunk?offset=" + std::to_string(offset);
+    std::string content((const char*)img.data() + offset, len);
+    return host::exchange(host::multipartRequest(uri.c_str(), content, "firmware.bin.gz", kAuth));
+}
+
+void overHttp() {
+    host::bootDevice();
+    std::vector<uint8_t> gz = image(6000, 0x1F, 0x8B);
+    uint8_t sha[OTA_SHA256_LEN];
+    shaOf(gz, sha);
+    std::string begin = "{\"size\":6000,\"sha256\":\"" + hex(sha, sizeof(sha)) + "\"}";
+
+    host::HttpResponse r = host::exchange(host::httpRequest("POST", "/api/ota/begin", begin, "application/json", kAuth));
+    CHECK_EQ(r.code, 200);
+    CHECK_STR(r.body, "{\"status\":\"success\",\"offset\":0,\"size\":6000}");
+    // A first chunk of one byte: the gzip magic is split across chunks
+    CHECK_EQ(chunk(gz, 0, 1).code, 200);
+    CHECK_EQ(chunk(gz, 1, 2999).code, 200);
+    r = chunk(gz, 5000, 1000); // Skips ahead: rejected, with the offset to resume from
+    CHECK_EQ(r.code, 409);
+    CHECK(r.body.find("\"offset\":3000") != std::string::npos);
+    r = host::exchange("GET", "/api/ota/status");
+    CHECK_STR(r.body, "{\"status\":\"success\",\"active\":true,\"offset\":3000,\"size\":6000,\"compressed\":true}");
+    // The client restarts with the same image: it resumes instead of starting over
+    r = host::exchange(host::httpRequest("POST", "/api/ota/begin", begin, "application/json", kAuth));
+    CHECK_STR(r.body, "{\"status\":\"success\",\"offset\":3000,\"size\":6000}");
+    CHECK_EQ(host::exchange(host::httpRequest("POST", "/api/ota/finish", "", "application/json", kAuth)).code, 409);
+    CHECK_EQ(chunk(gz, 3000, 3000).code, 200);
+    r = host::exchange(host::httpRequest("POST", "/api/ota/finish", "", "application/json", kAuth));
+    CHECK_EQ(r.code, 200);
+    CHECK(host::restartRequested());
+    CHECK(Update.installed() == gz);
+}
+
+} // namespace
+
+int main() {
+    shaVectors();
+    classification();
+    holdBack();
+    resumeAfterTruncation();
+    overHttp();
+    return TEST_RESULT("test_ota_stream");
+}
@@ -0,0 +1,144 @@
+// test_relay_schedule.cpp
+// Relay schedule pulses across power cuts and clock gaps: the persisted relay mask brings a
+// pulsed channel back on at boot, and seeding the timer wheel must then switch it off (window
+// over) or re-arm its end (window still open) instead of leaving it on for good. A schedule
+// that fires during a door pulse must not save the door's channel as on.
+#include "host_device.h"
+#include "host_test.h"
+
+#include <memory>
+
+namespace {
+
+const uint32_t kMonday = 1772409600; // 2026-03-02 00:00 UTC
+
+// A controller with the schedule handlers: the one the schedules are set through
+RTCManager* first = nullptr;
+
+host::HttpResponse post(RTCManager& device, const char* uri, const std::string& body) {
+    host::ConnectionPtr c = server.hostConnect(IPAddress(192, 168, 4, 2), 44000, host::nowUs());
+    c->send(host::httpRequest("POST", uri, body), host::nowUs());
+    while (c->responses.empty()) {
+        device.handleClient();
+        host::advanceUs(100);
+    }
+    c->clientClosed = true;
+    while (server.hostServing()) {
+        device.handleClient();
+    }
+    return c->responses.front();
+}
+
+// handleRelaySchedules() every 100 ms, as from loop(), until the given time of day
+void runUntil(RTCManager& device, int hour, int minute, int second) {
+    uint32_t until = kMonday + hour * 3600 + minute * 60 + second;
+    while (device.now().unixtime() < until) {
+        host::advanceUs(100000);
+        device.handleRelaySchedules();
+    }
+}
+
+// Power cut for offSeconds, then a boot as a sketch's setup() does it: relays restored from
+// storage first, then the RTC and the schedules
+std::unique_ptr<RTCManager> powerCycle(uint32_t offSeconds) {
+    digitalWrite(RELAY_PIN, LOW);
+    host::advanceUs((uint64_t)offSeconds * 1000000);
+    std::unique_ptr<RTCManager> device(new RTCManager(server, RELAY_PIN));
+    device->beginAccessFirst("SCLib-host", "host-pass"); // Network left to handleClient(), never called
+    return device;
+}
+
+void bootSchedules(RTCManager& device) {
+    CHECK(device.beginRTC());
+    device.beginRelaySchedules();
+}
+
+std::string pulseAt(int id, const char* time, int seconds) {
+    return "{\"id\":" + std::to_string(id) + ",\"time\":\"" + time + "\",\"action\":\"pulse\",\"pulse_s\":" +
+           std::to_string(seconds) + "}";
+}
+
+// Power lost 3 s into a 10 s pulse, back a minute later: restored on, then switched off
+void powerLossAfterWindow() {
+    CHECK_EQ(post(*first, "/api/relay/schedule/set", pulseAt(0, "08:00", 10)).code, 200);
+    runUntil(*first, 8, 0, 3);
+    CHECK_EQ(digitalRead(RELAY_PIN), HIGH);
+    CHECK_EQ(first->getRelayMaskFromEEPROM() & 1, 1);
+
+    std::unique_ptr<RTCManager> rebooted = powerCycle(60);
+    CHECK_EQ(digitalRead(RELAY_PIN), HIGH); // As saved
+    bootSchedules(*rebooted);
+    CHECK_EQ(digitalRead(RELAY_PIN), LOW);
+    CHECK_EQ(rebooted->getRelayMaskFromEEPROM() & 1, 0);
+}
+
+// Power lost 5 s into a 30 s pulse, back 10 s later: on until the pulse's own end
+void powerLossInsideWindow() {
+    std::unique_ptr<RTCManager> device = powerCycle(0);
+    bootSchedules(*device);
+    CHECK_EQ(post(*first, "/api/relay/schedule/set", pulseAt(1, "08:05", 30)).code, 200);
+    device->beginRelaySchedules(); // Picks up the entry written through the first controller
+    runUntil(*device, 8, 5, 5);
+    CHECK_EQ(digitalRead(RELAY_PIN), HIGH);
+
+    std::unique_ptr<RTCManager> rebooted = powerCycle(10);
+    bootSchedules(*rebooted);
+    CHECK_EQ(digitalRead(RELAY_PIN), HIGH);
+    runUntil(*rebooted, 8, 5, 28);
+    CHECK_EQ(digitalRead(RELAY_PIN), HIGH);
+    runUntil(*rebooted, 8, 5, 31);
+    CHECK_EQ(digitalRead(RELAY_PIN), LOW);
+    CHECK_EQ(rebooted->getRelayMaskFromEEPROM() & 1, 0);
+}
+
+// The loop stalls past RELAY_WHEEL_MAX_CATCHUP_S during a pulse, so the wheel is re-seeded:
+// the pulse's end timer goes with the old wheel, and the seed must switch the channel off
+void gapDuringPulse() {
+    std::unique_ptr<RTCManager> device = powerCycle(0);
+    bootSchedules(*device);
+    CHECK_EQ(post(*first, "/api/relay/schedule/set", pulseAt(2, "08:10", 30)).code, 200);
+    device->beginRelaySchedules();
+    runUntil(*device, 8, 10, 1);
+    CHECK_EQ(digitalRead(RELAY_PIN), HIGH);
+    host::advanceUs((RELAY_WHEEL_MAX_CATCHUP_S + 60) * 1000000ULL);
+    device->handleRelaySchedules();
+    CHECK_EQ(digitalRead(RELAY_PIN), LOW);
+}
+
+// A schedule switches the relay on while a grant holds the door open: the pulse still ends it,
+// so it is saved as off and the next boot restores the door closed
+void scheduleDuringPulse() {
+    host::bootDevice();
+    CHECK(host::loadTags(1));
+    CHECK_EQ(post(*first, "/api/relay/schedule/set", "{\"id\":3,\"time\":\"08:20\",\"action\":\"on\"}").code, 200);
+    runUntil(*first, 8, 19, 59);
+    host::HttpResponse granted = host::exchange("POST", "/api/users/use_tag", "{\"tag\":\"1000000000\"}");
+    CHECK(granted.body.find("\"found\":true") != std::string::npos);
+    CHECK_EQ(digitalRead(RELAY_PIN), HIGH);
+    runUntil(*first, 8, 20, 1);
+    CHECK_EQ(first->getRelayMaskFromEEPROM() & 1, 0);
+    uint64_t start = host::nowUs();
+    while (host::nowUs() < start + ACCESS_PULSE_MS * 1000ULL) {
+        host::loopOnce(10000);
+    }
+    CHECK_EQ(digitalRead(RELAY_PIN), LOW);
+
+    std::unique_ptr<RTCManager> rebooted = powerCycle(60);
+    CHECK_EQ(digitalRead(RELAY_PIN), LOW);
+}
+
+} // namespace
+
+int main() {
+    host::setRtcUnix(kMonday + 7 * 3600 + 59 * 60);
+    first = new RTCManager(server, RELAY_PIN);
+    first->beginAPAndWebServer("SCLib-host", "host-pass");
+    first->setupRTCEndpoints();
+    bootSchedules(*first);
+
+    powerLossAfterWindow();
+    powerLossInsideWindow();
+    gapDuringPulse();
+    scheduleDuringPulse();
+    return TEST_RESULT("test_relay_schedule");
+}
@@ -0,0 +1,166 @@
+// test_tag_codec.cpp
+// SC_TagCodec.h as tooling uses it: encode/decode round trips, every way a body is refused, the
+// size of a realistic export, and get_tags?format=delta decoded back to the stored tags.
+#include "SC_TagCodec.h"
+#include "host_device.h"
+#include "host_test.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace {
+
+std::vector<uint8_t> encode(std::vector<uint64_t> values) {
+    tagCodecSort(values.data(), values.size());
+    std::vector<uint8_t> out(TAG_CODEC_MAX_LEN(values.size()));
+    out.resize(tagCodecEncode(values.data(), values.size(), out.data()));
+    CHECK_EQ(out.size(), tagCodecEncodedLen(values.data(), values.size()));
+    return out;
+}
+
+bool decode(const std::vector<uint8_t>& in, std::vector<uint64_t>& values, size_t capacity) {
+    values.assign(capacity, 0);
+    size_t n = 0;
+    bool ok = tagCodecDecode(in.data(), in.size(), values.data(), capacity, n);
+    values.resize(ok ? n : 0);
+    return ok;
+}
+
+// Re-signs a body after it was edited, so only the edit is under test
+void resign(std::vector<uint8_t>& body) {
+    uint32_t crc = crc32(body.data(), body.size() - 4);
+    memcpy(body.data() + body.size() - 4, &crc, 4);
+}
+
+void sortMatchesStd() {
+    std::mt19937_64 rng(3);
+    for (size_t n : {0, 1, 2, 3, 17, 300, 10000}) {
+        std::vector<uint64_t> values(n);
+        for (uint64_t& v : values) {
+            v = rng() % 100000000000ULL;
+        }
+        values.push_back(values.empty() ? 5 : values[0]); // A duplicate
+        std::vector<uint64_t> expected = values;
+        std::sort(expected.begin(), expected.end());
+        tagCodecSort(values.data(), values.size());
+        CHECK(values == expected);
+    }
+}
+
+void roundTrip() {
+    std::vector<uint64_t> values = {21850107129ULL, 1000000000ULL, 7, 0, 1000000001ULL, 99999999999ULL};
+    std::vector<uint8_t> body = encode(values);
+    std::vector<uint64_t> decoded;
+    CHECK(decode(body, decoded, values.size()));
+    std::sort(values.begin(), values.end());
+    CHECK(decoded == values);
+
+    std::vector<uint64_t> none;
+    CHECK(decode(encode(none), decoded, 4));
+    CHECK_EQ(decoded.size(), 0);
+}
+
+// The largest 11-digit card number: 37 bits, six varint bytes, the per-tag worst case
+void elevenDigitMax() {
+    const uint64_t max = 99999999999ULL;
+    CHECK_EQ(tagCodecVarintLen(max), 6);
+    std::vector<uint8_t> body = encode({max});
+    CHECK_EQ(body.size(), 4 + 1 + 1 + 6 + 4);
+    CHECK(body.size() <= TAG_CODEC_MAX_LEN(1));
+    std::vector<uint64_t> decoded;
+    CHECK(decode(body, decoded, 1));
+    CHECK(decoded.size() == 1 && decoded[0] == max);
+
+    TagId tag;
+    uint64_t value;
+    CHECK(TagId::parse("99999999999", tag) && tagCodecValue(tag, value) && value == max);
+}
+
+void crcMismatch() {
+    std::vector<uint8_t> body = encode({1000000000ULL, 1000000005ULL, 1000000100ULL});
+    std::vector<uint64_t> decoded;
+    for (size_t i = 0; i < body.size(); i++) {
+        std::vector<uint8_t> flipped = body;
+        flipped[i] ^= 0x10;
+        CHECK(!decode(flipped, decoded, 3));
+    }
+}
+
+void truncated() {
+    std::vector<uint8_t> body = encode({1000000000ULL, 1000000005ULL, 1000000100ULL});
+    std::vector<uint64_t> decoded;
+    for (size_t len = 0; len < body.size(); len++) {
+        std::vector<uint8_t> cut(body.begin(), body.begin() + len);
+        CHECK(!decode(cut, decoded, 3));
+        // Cut inside the values but re-signed: the count promises more than there is
+        if (len > 4 + 1 + 1 + 4) {
+            std::vector<uint8_t> shortBody(body.begin(), body.begin() + len - 4);
+            shortBody.insert(shortBody.end(), 4, 0);
+            resign(shortBody);
+            CHECK(!decode(shortBody, decoded, 3));
+        }
+    }
+    // A varint whose continuation bit runs into the trailer
+    std::vector<uint8_t> open = body;
+    open[open.size() - 5] |= 0x80;
+    resign(open);
+    CHECK(!decode(open, decoded, 3));
+}
+
+void countOverCapacity() {
+    std::vector<uint8_t> body = encode({1, 2, 3, 4});
+    std::vector<uint64_t> decoded;
+    CHECK(!decode(body, decoded, 3));
+    CHECK(decode(body, decoded, 4));
+}
+
+// 300 tags drawn from one 200k-wide card range, as a site's badge batch would be
+void exportSize() {
+    std::mt19937_64 rng(1);
+    std::vector<uint64_t> values;
+    for (int i = 0; i < 300; i++) {
+        values.push_back(21850000000ULL + rng() % 200000);
+    }
+    std::vector<uint8_t> body = encode(values);
+    size_t json = 0;
+    for (uint64_t v : values) {
+        json += std::to_string(v).size() + 1;
+    }
+    printf("300 tags in a 200k range: %zu bytes encoded, %zu bytes as the JSON list\n", body.size(), json);
+    CHECK(body.size() < 2 * 300 + 16);
+}
+
+// get_tags?format=delta, streamed in TAG_EXPORT_CHUNK pieces, decodes to the stored tags
+void deviceExport() {
+    host::bootDevice();
+    CHECK_EQ(host::exchange("POST", "/api/users/delete_all_tags").code, 200);
+    const int tags = 250;
+    CHECK(host::loadTags(tags, 30000000000ULL));
+    host::advanceUs(10000000);
+    host::HttpResponse r = host::exchange("GET", "/api/users/get_tags?format=delta");
+    CHECK_EQ(r.code, 200);
+    CHECK_STR(r.contentType, TAG_EXPORT_DELTA_TYPE);
+    std::vector<uint8_t> body(r.body.begin(), r.body.end());
+    CHECK(body.size() > TAG_EXPORT_CHUNK);
+    std::vector<uint64_t> decoded;
+    CHECK(decode(body, decoded, tags));
+    CHECK_EQ(decoded.size(), tags);
+    for (int i = 0; i < tags && i < (int)decoded.size(); i++) {
+        CHECK_EQ(decoded[i], 30000000000ULL + i);
+    }
+}
+
+} // namespace
+
+int main() {
+    sortMatchesStd();
+    roundTrip();
+    elevenDigitMax();
+    crcMismatch();
+    truncated();
+    countOverCapacity();
+    exportSize();
+    deviceExport();
+    return TEST_RESULT("test_tag_codec");
+}
@@ -0,0 +1,247 @@
+// test_wiegand.cpp
+// WiegandDecoder and WiegandDebounce on recorded and generated (microseconds, bit) pulses, then
+// the whole path on the device: D0/D1 falling edges -> ISR ring -> handleWiegand -> decision.
+#include "host_device.h"
+#include "host_test.h"
+
+#include <string>
+#include <vector>
+
+namespace {
+
+// A 26-bit HID card (facility 18, card 4660) as captured from a reader, bits ~2 ms apart
+const WiegandPulse kRecorded26[] = {
+    {1000000, 1}, {1002001, 0}, {1003980, 0}, {1005990, 0}, {1007956, 1}, {1009925, 0}, {1011953, 0},
+    {1013925, 1}, {1015931, 0}, {1017965, 0}, {1019932, 0}, {1021956, 0}, {1023943, 1}, {1025907, 0},
+    {1027878, 0}, {1029893, 1}, {1031906, 0}, {1033874, 0}, {1035864, 0}, {1037835, 1}, {1039865, 1},
+    {1041879, 0}, {1043846, 1}, {1045878, 0}, {1047853, 0}, {1049841, 1},
+};
+const uint32_t kRecorded26Card = (18UL << 16) | 4660;
+
+// A frame of n bits (26 or 34) with correct parity around payload
+std::vector<uint8_t> frameBits(int n, uint32_t payload) {
+    int half = (n - 2) / 2;
+    std::vector<uint8_t> bits;
+    uint8_t lead = 0, trail = 1;
+    for (int i = 0; i < n - 2; i++) {
+        uint8_t b = (payload >> (n - 3 - i)) & 1;
+        (i < half ? lead : trail) ^= b;
+        bits.push_back(b);
+    }
+    bits.insert(bits.begin(), lead);
+    bits.push_back(trail);
+    return bits;
+}
+
+std::vector<WiegandPulse> pulses(const std::vector<uint8_t>& bits, uint32_t startUs, uint32_t spacingUs = 2000) {
+    std::vector<WiegandPulse> out;
+    for (size_t i = 0; i < bits.size(); i++) {
+        out.push_back({startUs + (uint32_t)i * spacingUs, bits[i]});
+    }
+    return out;
+}
+
+// Pushes the pulses, then polls a gap later; returns how many cards came out, the last in card
+int decode(WiegandDecoder& d, const std::vector<WiegandPulse>& in, uint32_t& card) {
+    int cards = 0;
+    for (const WiegandPulse& p : in) {
+        cards += d.push(p, card);
+    }
+    cards += d.poll(in.back().us + WIEGAND_FRAME_GAP_US + 1, card);
+    return cards;
+}
+
+void recordedFrame() {
+    WiegandDecoder d;
+    uint32_t card = 0;
+    for (const WiegandPulse& p : kRecorded26) {
+        CHECK(!d.push(p, card));
+    }
+    uint32_t last = kRecorded26[25].us;
+    CHECK(!d.poll(last + WIEGAND_FRAME_GAP_US, card)); // Not a full gap yet
+    CHECK(d.poll(last + WIEGAND_FRAME_GAP_US + 1, card));
+    CHECK_EQ(card, kRecorded26Card);
+    CHECK_EQ(d.rejected(), 0);
+    CHECK(!d.poll(last + 10 * WIEGAND_FRAME_GAP_US, card)); // Closed once
+}
+
+void validFrames() {
+    WiegandDecoder d;
+    uint32_t card = 0;
+    CHECK_EQ(decode(d, pulses(frameBits(34, 0xDEADBEEF), 0), card), 1);
+    CHECK_EQ(card, 0xDEADBEEF);
+    CHECK_EQ(decode(d, pulses(frameBits(26, 0xFFFFFF), 500000), card), 1);
+    CHECK_EQ(card, 0xFFFFFF);
+    CHECK_EQ(decode(d, pulses(frameBits(26, 0), 1000000), card), 1);
+    CHECK_EQ(card, 0);
+    CHECK_EQ(d.rejected(), 0);
+}
+
+void parityFailures() {
+    WiegandDecoder d;
+    uint32_t card = 0;
+    const int flips[] = {0, 1, 13, 25}; // Leading parity, first data bit, first bit of the second half, trailing parity
+    for (int flip : flips) {
+        std::vector<uint8_t> bits = frameBits(26, kRecorded26Card);
+        bits[flip] ^= 1;
+        CHECK_EQ(decode(d, pulses(bits, flip * 1000000), card), 0);
+    }
+    std::vector<uint8_t> bits = frameBits(34, 0x12345678);
+    bits[33] ^= 1;
+    CHECK_EQ(decode(d, pulses(bits, 9000000), card), 0);
+    CHECK_EQ(d.rejected(), 5);
+}
+
+void lengths() {
+    WiegandDecoder d;
+    uint32_t card = 0;
+    const int bad[] = {1, 25, 27, 33, 35, 64};
+    for (int n : bad) {
+        std::vector<uint8_t> bits = frameBits(26, 1);
+        bits.resize(n, 0);
+        CHECK_EQ(decode(d, pulses(bits, n * 1000000), card), 0);
+    }
+    CHECK_EQ(d.rejected(), 6);
+}
+
+// A burst of 256 + 26 (or 256 + 34) pulses used to wrap the 8-bit count back to a valid length,
+// and the last bits of the burst were then taken as a card
+void noiseBurstDoesNotWrap() {
+    WiegandDecoder d;
+    uint32_t card = 0;
+    const int frames[] = {26, 34};
+    for (int n : frames) {
+        std::vector<uint8_t> bits(256, 1);
+        std::vector<uint8_t> tail = frameBits(n, 0x00ABCDEF);
+        bits.insert(bits.end(), tail.begin(), tail.end());
+        CHECK_EQ(decode(d, pulses(bits, n * 10000000, 100), card), 0);
+    }
+    CHECK_EQ(d.rejected(), 2);
+    // The decoder is usable again after the burst
+    CHECK_EQ(decode(d, pulses(frameBits(26, kRecorded26Card), 900000000), card), 1);
+    CHECK_EQ(card, kRecorded26Card);
+}
+
+void gapFraming() {
+    WiegandDecoder d;
+    uint32_t card = 0;
+    // Bits just under a gap apart still form one frame
+    CHECK_EQ(decode(d, pulses(frameBits(26, 42), 0, WIEGAND_FRAME_GAP_US), card), 1);
+    CHECK_EQ(card, 42);
+    // Back-to-back frames: the first pulse of the next frame closes the previous one
+    std::vector<WiegandPulse> a = pulses(frameBits(26, 1001), 10000000);
+    std::vector<WiegandPulse> b = pulses(frameBits(34, 2002), a.back().us + WIEGAND_FRAME_GAP_US + 1);
+    int cards = 0;
+    for (const WiegandPulse& p : a) {
+        cards += d.push(p, card);
+    }
+    CHECK(d.push(b[0], card));
+    CHECK_EQ(card, 1001);
+    for (size_t i = 1; i < b.size(); i++) {
+        cards += d.push(b[i], card);
+    }
+    CHECK_EQ(cards, 0);
+    CHECK(d.poll(b.back().us + WIEGAND_FRAME_GAP_US + 1, card));
+    CHECK_EQ(card, 2002);
+    // A frame split by a gap is two bad frames, not one good one
+    std::vector<WiegandPulse> split = pulses(frameBits(26, 3003), 20000000);
+    for (size_t i = 13; i < split.size(); i++) {
+        split[i].us += WIEGAND_FRAME_GAP_US;
+    }
+    CHECK_EQ(decode(d, split, card), 0);
+    CHECK_EQ(d.rejected(), 2);
+    // micros() wrapping in the middle of a frame
+    CHECK_EQ(decode(d, pulses(frameBits(26, 4004), 0xFFFFFFFFu - 20000), card), 1);
+    CHECK_EQ(card, 4004);
+}
+
+void debounce() {
+    WiegandDebounce db;
+    CHECK(db.accept(7, 1000));
+    CHECK(!db.accept(7, 1500));
+    CHECK(!db.accept(7, 1000 + WIEGAND_REPEAT_MS + 100)); // Held on the reader: each repeat extends the window
+    CHECK(db.accept(8, 4000));                             // Another card is never held back
+    CHECK(db.accept(7, 4100));
+    CHECK(db.accept(7, 4100 + WIEGAND_REPEAT_MS));          // A full window after the last read
+}
+
+// Falling edges on D0/D1 at the recorded times, through the ISRs and handleWiegand()
+void sendOnPins(uint8_t d0, uint8_t d1, const std::vector<WiegandPulse>& in) {
+    uint64_t start = host::nowUs();
+    for (const WiegandPulse& p : in) {
+        uint64_t at = start + (p.us - in[0].us);
+        if (at > host::nowUs()) {
+            host::advanceUs(at - host::nowUs());
+        }
+        uint8_t pin = p.bit ? d1 : d0;
+        host::drivePin(pin, LOW);
+        host::advanceUs(50); // 50 us pulse
+        host::drivePin(pin, HIGH);
+    }
+    for (int i = 0; i < 100; i++) {
+        host::loopOnce(1000); // 100 ms: past the frame gap
+    }
+}
+
+std::string totals() {
+    host::HttpResponse r = host::exchange("GET", "/api/users/get_statistics");
+    size_t at = r.body.find("\"total\":");
+    return at == std::string::npos ? r.body : r.body.substr(at, r.body.find('}', at) - at + 1);
+}
+
+void onDevice() {
+    host::bootDevice();
+    const uint8_t d0 = 4, d1 = 5;
+    users.beginWiegand(d0, d1);
+    CHECK_EQ(host::exchange("POST", "/api/users/delete_all_tags").code, 200); // Erased storage holds no count yet
+    const uint32_t secondCard = 0x0A0B0C0D;
+    CHECK(users.storeTag(wiegandTag(kRecorded26Card)));
+    CHECK(users.storeTag(wiegandTag(secondCard)));
+    CHECK_STR(totals(), "\"total\":{\"grants\":0,\"denials\":0}");
+
+    // A grant starts the door pulse and returns: a second card read during the pulse is decided
+    // straight away, and the loop switches the relay off when the pulse is up
+    uint64_t start = host::nowUs();
+    std::vector<WiegandPulse> recorded(kRecorded26, kRecorded26 + 26);
+    sendOnPins(d0, d1, recorded);
+    CHECK_EQ(digitalRead(RELAY_PIN), HIGH);
+    sendOnPins(d0, d1, pulses(frameBits(34, secondCard), 0));
+    CHECK_EQ(digitalRead(RELAY_PIN), HIGH);
+    uint64_t second = host::nowUs();
+    CHECK(second - start < (uint64_t)ACCESS_PULSE_MS * 1000 / 2); // Both frames and 200 loop passes
+    CHECK_STR(totals(), "\"total\":{\"grants\":2,\"denials\":0}");
+    while (host::nowUs() - second < (uint64_t)(ACCESS_PULSE_MS + 500) * 1000) {
+        host::loopOnce(10000);
+    }
+    CHECK_EQ(digitalRead(RELAY_PIN), LOW);
+
+    std::vector<WiegandPulse> unknown = pulses(frameBits(34, 0x01020304), 0);
+    sendOnPins(d0, d1, unknown);
+    CHECK_STR(totals(), "\"total\":{\"grants\":2,\"denials\":1}");
+    sendOnPins(d0, d1, unknown); // Within WIEGAND_REPEAT_MS of the first read
+    CHECK_STR(totals(), "\"total\":{\"grants\":2,\"denials\":1}");
+    host::advanceUs((uint64_t)WIEGAND_REPEAT_MS * 1000);
+    sendOnPins(d0, d1, unknown);
+    CHECK_STR(totals(), "\"total\":{\"grants\":2,\"denials\":2}");
+
+    // Noise on the lines: the ring keeps the first WIEGAND_RING_SIZE pulses, none of it is a card
+    std::vector<uint8_t> noise(256, 0);
+    std::vector<uint8_t> tail = frameBits(26, kRecorded26Card);
+    noise.insert(noise.end(), tail.begin(), tail.end());
+    sendOnPins(d0, d1, pulses(noise, 0, 100));
+    CHECK_STR(totals(), "\"total\":{\"grants\":2,\"denials\":2}");
+}
+
+} // namespace
+
+int main() {
+    recordedFrame();
+    validFrames();
+    parityFailures();
+    lengths();
+    noiseBurstDoesNotWrap();
+    gapFraming();
+    debounce();
+    onDevice();
+    return TEST_RESULT("test_wiegand");
+}